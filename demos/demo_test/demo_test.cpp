@@ -24,12 +24,18 @@
 #endif
 
 #include <hltypes/harray.h>
+#include <hltypes/hfile.h>
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 #include <hltypes/hthread.h>
 
 #include <xal/AudioManager.h>
+#include <xal/Buffer.h>
 #include <xal/Player.h>
+#include <xal/Sound.h>
+#include <xal/Source.h>
 #include <xal/xal.h>
 #include <xalutil/ParallelSoundManager.h>
 #include <xalutil/Playlist.h>
@@ -49,6 +55,11 @@
 //#define _TEST_FADE_IN_OUT
 //#define _TEST_COMPLEX_HANDLER
 //#define _TEST_MEMORY_MANAGEMENT
+//#define _TEST_SEEK
+//#define _TEST_OPUS // requires _FORMAT_OPUS and an Ogg Opus file named speech.opus in the media folder
+//#define _TEST_SPX // requires _FORMAT_SPX
+//#define _TEST_FLAC_DECODE
+//#define _TEST_SOUND_BANK
 
 //#define _TEST_SOURCE_HANDLING // usually OpenAL only
 
@@ -81,7 +92,16 @@
 #define SOURCE_MODE xal::DISK
 #endif
 
+#define S_OPUS "speech"
+#define S_SPX "wb_male"
+#define S_FLAC "bark_3"
+
 #define OPENAL_MAX_SOURCES 16 // needed when using OpenAL
+#define SEEK_CHECK_SAMPLES 1024
+#define SEEK_TOLERANCE 64
+#define DECODE_RUNS 200
+#define SOUND_BANK_RUNS 20
+#define SOUND_BANK_FILE "demo_test.xsb"
 
 void _test_basic(xal::Player* player)
 {
@@ -337,6 +357,184 @@ void _test_memory_management(xal::Player* player)
 	xal::mgr->destroyPlayer(p1);
 }
 
+void _test_seek(xal::Player* player)
+{
+	hlog::write("", "  - start test seek...");
+	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
+	p1->play();
+	xal::mgr->update(0.1f);
+	float duration = p1->getDuration();
+	int64_t time = 0;
+	int64_t total = 0;
+	int64_t worst = 0;
+	for_iter (i, 0, 20)
+	{
+		time = htickCount();
+		p1->seek(duration * ((i * 7) % 20) / 20.0f);
+		time = htickCount() - time;
+		total += time;
+		worst = hmax(worst, time);
+		hlog::writef("", "T:%d seek to %.2fs took %d ms, now at %.2fs", i, duration * ((i * 7) % 20) / 20.0f, (int)time, p1->getTimePosition());
+		hthread::sleep(250);
+		xal::mgr->update(0.25f);
+	}
+	hlog::writef("", "  - seek latency: average %.1f ms, worst %d ms", total / 20.0f, (int)worst);
+	p1->stop();
+	xal::mgr->update(0.1f);
+	xal::mgr->destroyPlayer(p1);
+}
+
+int _find_seek_error(short* reference, int64_t referenceSamples, short* data, int samples, int channels, int64_t position)
+{
+	int result = 0;
+	int64_t best = -1;
+	int64_t difference = 0;
+	int offset = 0;
+	// starts with no offset so silence doesn't report an error
+	for_iter (i, 0, SEEK_TOLERANCE * 2 + 1)
+	{
+		offset = (i % 2 == 0 ? i / 2 : -(i + 1) / 2);
+		if (position + offset < 0 || position + offset + samples > referenceSamples)
+		{
+			continue;
+		}
+		difference = 0;
+		for_iter (j, 0, samples * channels)
+		{
+			difference += habs(data[j] - reference[(position + offset) * channels + j]);
+		}
+		if (best < 0 || difference < best)
+		{
+			best = difference;
+			result = offset;
+		}
+	}
+	return result;
+}
+
+void _test_decode(chstr name)
+{
+	hlog::write("", "  - start test decode " + name + "...");
+	xal::Sound* sound = xal::mgr->getSound(name);
+	if (sound == NULL)
+	{
+		hlog::error("", "  - sound does not exist: " + name);
+		return;
+	}
+	int channels = sound->getChannels();
+	int frameSize = channels * sound->getBitsPerSample() / 8;
+	// the length from the headers has to match what the decoder actually produces
+	int64_t headerSamples = sound->getSize() / frameSize;
+	hstream reference;
+	sound->readPcmData(reference);
+	int64_t samples = reference.size() / frameSize;
+	hlog::writef("", "  - length: headers %d samples, decoded %d samples%s", (int)headerSamples, (int)samples, (headerSamples == samples ? "" : " MISMATCH"));
+	// data decoded after seeking has to line up with the data decoded from the beginning
+	xal::Source* source = sound->getBuffer()->getSource();
+	if (!source->open())
+	{
+		hlog::error("", "  - cannot open source: " + name);
+		return;
+	}
+	hstream chunk;
+	int64_t position = 0;
+	int read = 0;
+	int error = 0;
+	int errors = 0;
+	for_iter (i, 0, 10)
+	{
+		position = hmax(samples * i / 10 - SEEK_CHECK_SAMPLES + i * 37, (int64_t)0);
+		chunk.clear();
+		if (!source->seek(position))
+		{
+			hlog::writef("", "  - seek to %d failed", (int)position);
+			++errors;
+			continue;
+		}
+		read = source->loadChunk(chunk, SEEK_CHECK_SAMPLES * frameSize) / frameSize;
+		error = _find_seek_error((short*)(unsigned char*)reference, samples, (short*)(unsigned char*)chunk, read, channels, position);
+		hlog::writef("", "  - seek to %d is off by %d samples", (int)position, error);
+		if (error != 0)
+		{
+			++errors;
+		}
+	}
+	source->close();
+	hlog::writef("", "  - %d of 10 seeks inaccurate", errors);
+}
+
+void _test_flac_decode()
+{
+	hlog::write("", "  - start test FLAC decode...");
+	xal::Sound* sound = xal::mgr->getSound(S_FLAC);
+	if (sound == NULL)
+	{
+		hlog::error("", "  - sound does not exist: " S_FLAC);
+		return;
+	}
+	// the Source is decoded directly so neither reading the file nor the Buffer is measured
+	xal::Source* source = sound->getBuffer()->getSource();
+	if (!source->open())
+	{
+		hlog::error("", "  - cannot open source: " S_FLAC);
+		return;
+	}
+	hstream output;
+	int64_t bytes = 0;
+	int64_t time = htickCount();
+	for_iter (i, 0, DECODE_RUNS)
+	{
+		source->rewind();
+		output.clear();
+		source->load(output);
+		bytes += output.size();
+	}
+	time = hmax(htickCount() - time, (int64_t)1);
+	source->close();
+	hlog::writef("", "  - decoded %.1f MB in %d ms: %.1f MB/s", bytes / 1048576.0f, (int)time, bytes / 1048576.0f * 1000.0f / time);
+}
+
+void _load_sounds(harray<hstr> names)
+{
+	foreach (hstr, it, names)
+	{
+		xal::mgr->getSound(*it)->getBuffer()->prepare();
+	}
+}
+
+void _test_sound_bank()
+{
+	hlog::write("", "  - start test sound bank...");
+	if (!xal::mgr->packSoundBank(SOUND_BANK_FILE, RESOURCE_PATH "streamable"))
+	{
+		hlog::error("", "  - cannot pack sound bank: " SOUND_BANK_FILE);
+		return;
+	}
+	xal::mgr->createCategory("bank_files", xal::FULL, xal::DISK);
+	harray<hstr> names;
+	int count = 0;
+	int64_t filesTime = 0;
+	int64_t bankTime = 0;
+	int64_t time = 0;
+	for_iter (i, 0, SOUND_BANK_RUNS)
+	{
+		time = htickCount();
+		names = xal::mgr->createSoundsFromPath(RESOURCE_PATH "streamable", "bank_files", "files_");
+		_load_sounds(names);
+		filesTime += htickCount() - time;
+		xal::mgr->destroySoundsWithPrefix("files_");
+		time = htickCount();
+		names = xal::mgr->createSoundsFromSoundBank(SOUND_BANK_FILE, "bank_bank", "bank_");
+		_load_sounds(names);
+		bankTime += htickCount() - time;
+		count = names.size();
+		xal::mgr->destroySoundsWithPrefix("bank_");
+	}
+	hlog::writef("", "  - %d sounds, per-file: %.2f ms per run, sound bank: %.2f ms per run", count,
+		filesTime / (float)SOUND_BANK_RUNS, bankTime / (float)SOUND_BANK_RUNS);
+	hfile::remove(SOUND_BANK_FILE);
+}
+
 void _test_sources(xal::Player* player)
 {
 	hlog::write("", "  - start test sources...");
@@ -466,6 +664,21 @@ int main(Platform::Array<Platform::String^>^ args)
 #ifdef _TEST_MEMORY_MANAGEMENT
 	_test_memory_management(player);
 #endif
+#ifdef _TEST_SEEK
+	_test_seek(player);
+#endif
+#ifdef _TEST_OPUS
+	_test_decode(S_OPUS);
+#endif
+#ifdef _TEST_SPX
+	_test_decode(S_SPX);
+#endif
+#ifdef _TEST_FLAC_DECODE
+	_test_flac_decode();
+#endif
+#ifdef _TEST_SOUND_BANK
+	_test_sound_bank();
+#endif
 #ifdef _TEST_SOURCE_HANDLING
 	_test_sources(player);
 #endif
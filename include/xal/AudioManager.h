@@ -23,8 +23,8 @@
 
 #include "xalExport.h"
 
-#define STREAM_BUFFER_COUNT 8 // greater or equal to 2
-#define STREAM_BUFFER_SIZE 32768 // equal to any power of 2
+#define STREAM_BUFFER_COUNT 8 // greater or equal to 2, default for Category::setStreamBufferCount()
+#define STREAM_BUFFER_SIZE 32768 // equal to any power of 2, default for Category::setStreamBufferSize()
 #define STREAM_BUFFER (STREAM_BUFFER_COUNT * STREAM_BUFFER_SIZE)
 
 namespace xal
@@ -34,8 +34,9 @@ namespace xal
 		FLAC,
 		M4A,
 		OGG,
-		SPX, // not supported yet
+		SPX,
 		WAV,
+		OPUS,
 		UNKNOWN
 	};
 
@@ -52,7 +53,10 @@ namespace xal
 		/// @brief Buffers when first need arises, clears memory after usage.
 		ON_DEMAND = 4,
 		/// @brief Buffers in streamed mode.
-		STREAMED = 5
+		STREAMED = 5,
+		/// @brief Keeps the encoded data in RAM and decodes it on play into a small ring per Player.
+		/// @note The most frequently played Sounds are kept fully decoded in the decoded cache (see AudioManager::setDecodedCacheSize()).
+		COMPRESSED = 6
 	};
 
 	enum SourceMode
@@ -60,7 +64,9 @@ namespace xal
 		/// @brief Leaves data on permanent storage device.
 		DISK = 0,
 		/// @brief Copies data to RAM buffer and accesses it from there.
-		RAM = 1
+		RAM = 1,
+		/// @brief Maps the file into memory once per file and accesses it from there, uses DISK if the file can't be mapped.
+		MMAP = 2
 	};
 
 	class Buffer;
@@ -68,6 +74,7 @@ namespace xal
 	class Player;
 	class Sound;
 	class Source;
+	class UpdateEvent;
 
 	/// @brief Provides generic functionality regarding audio management.
 	class xalExport AudioManager
@@ -93,6 +100,14 @@ namespace xal
 		HL_DEFINE_IS(enabled, Enabled);
 		HL_DEFINE_IS(suspended, Suspended);
 		HL_DEFINE_GETSET(float, idlePlayerUnloadTime, IdlePlayerUnloadTime);
+		HL_DEFINE_ISSET(parallelDecoding, ParallelDecoding);
+		HL_DEFINE_GETSET(int, decodedCacheSize, DecodedCacheSize);
+		HL_DEFINE_GETSET(int, decodedCachePlayCount, DecodedCachePlayCount);
+		HL_DEFINE_ISSET(streamFeeding, StreamFeeding);
+		HL_DEFINE_ISSET(streamFeederRealTime, StreamFeederRealTime);
+		HL_DEFINE_GETSET(int, streamFeederCpuAffinity, StreamFeederCpuAffinity);
+		HL_DEFINE_GETSET(float, scheduleLookahead, ScheduleLookahead);
+		HL_DEFINE_GETSET(int, maxVoices, MaxVoices);
 		HL_DEFINE_GET(hstr, deviceName, DeviceName);
 		inline bool isThreaded() { return (this->thread != NULL); }
 		HL_DEFINE_GET(float, updateTime, UpdateTime);
@@ -100,6 +115,9 @@ namespace xal
 		void setGlobalGain(float value);
 		harray<Player*> getPlayers();
 		hmap<hstr, Sound*> getSounds();
+		/// @return The current time of the output clock in samples at the AudioManager's sampling rate.
+		/// @note Used for scheduling with Player::playAt().
+		int64_t getOutputSampleTime();
 
 		/// @brief Updates all audio processing.
 		/// @param[in] timeDelta Time since the call of this method in seconds.
@@ -151,6 +169,33 @@ namespace xal
 		/// @return A list of all Sound names that were created.
 		/// @note If the Category does not exist, it will be created.
 		harray<hstr> createSoundsFromPath(chstr path, chstr categoryName, chstr prefix);
+		/// @brief Creates Sounds from all files in a sound bank and assigns them to a Category.
+		/// @param[in] filename Filename of the sound bank.
+		/// @param[in] categoryName Name for the Category.
+		/// @param[in] prefix Used to differentiate between Sounds that have the same filename (e.g. by using a directory path as prefix).
+		/// @return A list of all Sound names that were created.
+		/// @note If the Category does not exist, it will be created. The sound bank is mapped into memory once and all Sources read directly from it.
+		harray<hstr> createSoundsFromSoundBank(chstr filename, chstr categoryName, chstr prefix = "");
+		/// @brief Packs all audio files from a path into a sound bank.
+		/// @param[in] filename Filename of the sound bank.
+		/// @param[in] path Path where the audio files are located.
+		/// @return True if the sound bank was written successfully.
+		bool packSoundBank(chstr filename, chstr path);
+		/// @brief Loads the meta-data of Sounds on multiple threads without opening them for decoding.
+		/// @param[in] soundNames Names of the Sounds.
+		/// @note Useful to avoid stalls when querying e.g. durations of many Sounds for the first time.
+		void loadMetaData(harray<hstr> soundNames);
+		/// @brief Loads a meta-data manifest so Buffers don't have to probe their files.
+		/// @param[in] filename Filename of the manifest.
+		/// @return True if the manifest was loaded successfully.
+		/// @note Should be called before Sounds are created. Entries of files that were modified in the meantime are ignored.
+		/// @note Each Sound still reads its file's size and modification time from the file system. Meta-data of an entry is
+		/// discarded when the file is first opened if the entry's format doesn't match the file's magic bytes.
+		bool loadMetaDataManifest(chstr filename);
+		/// @brief Probes all existing Sounds and saves their meta-data into a manifest.
+		/// @param[in] filename Filename of the manifest.
+		/// @return True if the manifest was saved successfully.
+		bool saveMetaDataManifest(chstr filename);
 
 		/// @brief Creates a Player for a Sound.
 		/// @param[in] soundName Name of the Sound for which the player will be used.
@@ -178,6 +223,12 @@ namespace xal
 		/// @param[in] gain The gain of the Sound.
 		/// @note If the audio manager is suspended, this does nothing.
 		void playAsync(chstr soundName, float fadeTime = 0.0f, bool looping = false, float gain = 1.0f);
+		/// @brief Starts playing a group of Players together so they start on the same output frame.
+		/// @param[in] players The Players to start.
+		/// @param[in] fadeTime Time how long to fade in the Sounds.
+		/// @param[in] looping Whether the Sounds should be looped.
+		/// @note All data is prepared before any of the Players is started. Players that are already playing are not restarted.
+		void playGroup(harray<Player*> players, float fadeTime = 0.0f, bool looping = false);
 		/// @brief Stops all Sound instances that were played in a fire-and-forget fashion.
 		/// @param[in] soundName Name of the Sound.
 		/// @param[in] fadeTime Time how long to fade out the Sounds.
@@ -233,9 +284,34 @@ namespace xal
 		/// @brief Finds an actual audio filename.
 		/// @param[in] filename Reference filename for the audio file.
 		/// @return The actual audio filename.
+		/// @note Results are cached, including files that were not found.
 		virtual hstr findAudioFile(chstr filename);
+		/// @brief Clears the cached results of findAudioFile().
+		/// @note This should be called when audio files are added or removed during runtime.
+		void clearAudioFileCache();
 
 	protected:
+		/// @brief Meta-data of an audio file as stored in a manifest.
+		struct ManifestEntry
+		{
+			/// @brief Modification time of the file when the entry was created.
+			int64_t modificationTime;
+			/// @brief File size of the source.
+			int fileSize;
+			/// @brief File format.
+			Format format;
+			/// @brief Byte-size of the audio data.
+			int size;
+			/// @brief Number of channels in the audio data.
+			int channels;
+			/// @brief Sampling rate of the audio data.
+			int samplingRate;
+			/// @brief Number of bits per sample in the audio data.
+			int bitsPerSample;
+			/// @brief Length of the audio data in seconds.
+			float duration;
+		};
+
 		/// @brief Constructor.
 		/// @param[in] backendId Special ID needed by some audio systems.
 		/// @param[in] threaded Whether update should be handled in a separate thread.
@@ -263,6 +339,29 @@ namespace xal
 		bool threaded;
 		/// @brief How long a Player needs to remain inactive for its data to be cleared.
 		float idlePlayerUnloadTime;
+		/// @brief Whether long Sounds that are fully decoded from RAM may be split into segments that are decoded on multiple threads.
+		/// @note Only used by Sources that support it and only if the decoded result is identical to a serial decode.
+		bool parallelDecoding;
+		/// @brief Whether streams are refilled by a separate stream feeder thread instead of the update thread.
+		/// @note Only used with threaded updating, has to be set before init() and only works with audio-systems that support it. The data is decoded ahead by a stream decoder thread with normal priority.
+		bool streamFeeding;
+		/// @brief Whether the stream feeder thread uses a real-time scheduling policy.
+		bool streamFeederRealTime;
+		/// @brief Bit mask of the CPU cores on which the stream feeder thread may run, 0 for no restriction.
+		int streamFeederCpuAffinity;
+		/// @brief Maximum number of Players that use a voice of the audio-system at the same time, 0 for no limit.
+		/// @note Less important Players become virtual if the limit is exceeded.
+		int maxVoices;
+		/// @brief Number of voices at which the audio-system ran out of voices, 0 if it didn't happen since voices were last released.
+		int systemVoiceLimit;
+		/// @brief How long before its start time a scheduled Player's data is prepared (in seconds).
+		float scheduleLookahead;
+		/// @brief Tick count at which the default output clock started.
+		int64_t clockStartTime;
+		/// @brief Maximum byte-size of the decoded data of COMPRESSED Buffers kept in the decoded cache.
+		int decodedCacheSize;
+		/// @brief How many times a COMPRESSED Sound has to be played before its decoded data is kept in the decoded cache.
+		int decodedCachePlayCount;
 		/// @brief Device name which is required for some audio systems.
 		hstr deviceName;
 		/// @brief How much time should pass between updates when "threaded" is enabled.
@@ -282,15 +381,33 @@ namespace xal
 		hmap<hstr, Sound*> sounds;
 		/// @brief List Buffer instances.
 		harray<Buffer*> buffers;
+		/// @brief COMPRESSED Buffer instances that are kept decoded in the decoded cache.
+		harray<Buffer*> decodedBuffers;
+		/// @brief Meta-data manifest entries by filename.
+		hmap<hstr, ManifestEntry> manifest;
 		/// @brief List of file extensions supported.
 		harray<hstr> extensions;
+		/// @brief Cached results of findAudioFile(), an empty string means that the file was not found.
+		hmap<hstr, hstr> audioFiles;
+		/// @brief Mutex for access to the cached audio filenames.
+		hmutex audioFilesMutex;
 		/// @brief Thread instance handling the threaded update.
 		hthread* thread;
 		/// @brief Whether the threaded update is running.
 		bool threadRunning;
+		/// @brief Event on which the update thread sleeps until the next Player or Buffer needs to be updated.
+		UpdateEvent* updateEvent;
 		/// @brief Mutex for data access when threaded updating is used.
 		hmutex mutex; // a mute ex would be nice
 
+		/// @brief Calculates how long the update thread can sleep until a Player or a Buffer needs to be updated.
+		/// @return The time in seconds or a negative value if there is nothing to update.
+		/// @note This method is not thread-safe and is for internal usage only.
+		float _calcUpdateDelay();
+		/// @brief Wakes up the update thread so it can recalculate when the next update is needed.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _wakeUpdate();
+
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _setGlobalGain(float value);
 		/// @note This method is not thread-safe and is for internal usage only.
@@ -298,6 +415,11 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		hmap<hstr, Sound*> _getSounds();
 
+		/// @brief Finds an actual audio filename without using the cache.
+		/// @param[in] filename Reference filename for the audio file.
+		/// @return The actual audio filename.
+		hstr _findAudioFile(chstr filename);
+
 		/// @note Starts the thread for threaded update.
 		void _startThreading();
 		
@@ -321,6 +443,14 @@ namespace xal
 		harray<hstr> _createSoundsFromPath(chstr path, chstr prefix);
 		/// @note This method is not thread-safe and is for internal usage only.
 		harray<hstr> _createSoundsFromPath(chstr path, chstr category, chstr prefix);
+		/// @note This method is not thread-safe and is for internal usage only.
+		harray<hstr> _createSoundsFromSoundBank(chstr filename, chstr categoryName, chstr prefix);
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _loadMetaData(harray<hstr> soundNames);
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _loadMetaDataManifest(chstr filename);
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _saveMetaDataManifest(chstr filename);
 
 		/// @note This method is not thread-safe and is for internal usage only.
 		Player* _createPlayer(chstr name);
@@ -336,20 +466,58 @@ namespace xal
 		void _destroyManagedPlayer(Player* player);
 
 		/// @note This method is not thread-safe and is for internal usage only.
-		Buffer* _createBuffer(Sound* sound);
+		Buffer* _createBuffer(Sound* sound, Buffer* compressedBuffer = NULL);
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _destroyBuffer(Buffer* buffer);
+		/// @brief Counts a play of a COMPRESSED Buffer and moves it into the decoded cache once it's played frequently enough.
+		/// @param[in] buffer The shared Buffer of the played Sound.
+		/// @note Less frequently played Buffers that are not in use are evicted to stay within the decoded cache size.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _registerCompressedPlay(Buffer* buffer);
+
+		/// @brief Gets all Players that currently use a voice of the audio-system.
+		/// @param[in] except Player that is not included.
+		/// @return The Players.
+		/// @note This method is not thread-safe and is for internal usage only.
+		harray<Player*> _getVoices(Player* except = NULL);
+		/// @brief Checks the voice limits for a Player that wants to use a voice and makes less important Players virtual if needed.
+		/// @param[in] player The Player.
+		/// @return True if the Player may use a voice.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _acquireVoice(Player* player);
+		/// @brief Checks a single voice limit and makes the least important competing Player virtual if it's exceeded.
+		/// @param[in] player The Player that wants to use a voice.
+		/// @param[in,out] voices Players that currently use a voice, a Player that was made virtual is removed.
+		/// @param[in] limit The limit, 0 for no limit.
+		/// @param[in] sound Only Players of this Sound compete if not NULL.
+		/// @param[in] category Only Players of this Category compete if not NULL.
+		/// @return True if the limit is not exceeded by the Player.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _reserveVoice(Player* player, harray<Player*>& voices, int limit, Sound* sound, Category* category);
+		/// @brief Remembers how many voices the audio-system supports after it ran out of them until voices are released.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _registerSystemVoiceLimit();
+		/// @brief Makes inaudible Players virtual and gives free voices to virtual Players, the most important ones first.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _updateVirtualVoices();
 
 		/// @note This method is not thread-safe and is for internal usage only.
 		virtual Player* _createSystemPlayer(Sound* sound) = 0;
 		/// @note This method is not thread-safe and is for internal usage only.
 		virtual Source* _createSource(chstr filename, SourceMode sourceMode, BufferMode bufferMode, Format format);
+		/// @brief Starts the audio-system's voices of prepared Players.
+		/// @param[in] players The Players to start.
+		/// @note Audio-systems that can start multiple voices atomically should override this.
+		/// @note This method is not thread-safe and is for internal usage only.
+		virtual void _systemPlayGroup(harray<Player*> players);
 
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _play(chstr soundName, float fadeTime, bool looping, float gain);
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _playAsync(chstr soundName, float fadeTime, bool looping, float gain);
 		/// @note This method is not thread-safe and is for internal usage only.
+		void _playGroup(harray<Player*> players, float fadeTime, bool looping);
+		/// @note This method is not thread-safe and is for internal usage only.
 		void _stop(chstr soundName, float fadeTime);
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _stopFirst(chstr soundName, float fadeTime);
@@ -374,10 +542,20 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		virtual void _resumeAudio();
 
+		/// @return The current time of the output clock in samples.
+		/// @note The default clock is derived from the system's tick count, audio-systems with a real output clock should override this.
+		/// @note This method is not thread-safe and is for internal usage only.
+		virtual int64_t _getOutputSampleTime();
+
 		/// @brief Depending on the audio manager implementation, this method may convert audio data to the appropriate format (bit rate, channel number, sampling rate).
 		/// @param[in] source Source object that holds the data.
 		/// @param[in,out] stream The data stream buffer.
 		virtual void _convertStream(Source* source, hstream& stream) { }
+		/// @brief Checks whether _convertStream() would change the data of a Source.
+		/// @param[in] source Source object that holds the data.
+		/// @return True if the data needs to be converted.
+		/// @note Data that doesn't need conversion may be used directly from the Source's memory.
+		virtual bool _isConversionRequired(Source* source) { return false; }
 
 		/// @brief Special additional processing for suspension, required for some implementations.
 		/// @note This method is not thread-safe and is for internal usage only.
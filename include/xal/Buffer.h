@@ -33,25 +33,41 @@ namespace xal
 	public:
 		friend class AudioManager;
 		friend class BufferAsync;
+		friend class Player;
+		friend class StreamFeeder;
 
 		/// @brief Constructor.
 		/// @param[in] sound Sound object for which to create the buffer.
-		Buffer(Sound* sound);
+		/// @param[in] compressedBuffer The Sound's COMPRESSED Buffer if this Buffer is a Player's own ring that decodes its encoded data.
+		Buffer(Sound* sound, Buffer* compressedBuffer = NULL);
 		/// @brief Destructor.
 		~Buffer();
 
 		HL_DEFINE_GET(hstr, filename, Filename);
 		HL_DEFINE_GET(int, fileSize, FileSize);
 		inline hstream& getStream() { return this->stream; }
+		/// @return Current data provided by the Buffer.
+		/// @note The data may be referenced directly from the Source's memory instead of the stream.
+		unsigned char* getData();
+		/// @return Byte-size of the current data provided by the Buffer.
+		int getDataSize();
 		HL_DEFINE_GET(Source*, source, Source);
 		HL_DEFINE_GET(float, idleTime, IdleTime);
+		HL_DEFINE_GET(int, playCount, PlayCount);
 
 		int getSize();
 		int getChannels();
 		int getSamplingRate();
 		int getBitsPerSample();
 		float getDuration();
-		Format getFormat();
+		/// @note Until the file is opened this is the format from the manifest or the file extension.
+		HL_DEFINE_GET(Format, format, Format);
+		/// @return First sample of the loop.
+		/// @note Loop points are only used by streamed Buffers and are available once the Source was opened.
+		HL_DEFINE_GET(int64_t, loopStart, LoopStart);
+		/// @return Sample at which the loop ends or 0 if the loop ends with the audio data.
+		/// @note Loop points are only used by streamed Buffers and are available once the Source was opened.
+		HL_DEFINE_GET(int64_t, loopEnd, LoopEnd);
 		/// @return True if the Buffer's data is loaded.
 		bool isLoaded();
 		/// @return True if the Buffer's data is queued for asynchronous loading.
@@ -60,14 +76,21 @@ namespace xal
 		bool isStreamed();
 		/// @return True if the Buffer's data is managed.
 		bool isMemoryManaged();
-		// TODO
-		//bool setOffset(int value);
+		/// @return True if the Buffer keeps the encoded data in RAM.
+		bool isCompressed();
+		/// @return True if the data is decoded ahead of playback and there is still data left to hand out.
+		/// @note Streams of fed Players run dry before their end if the decoding can't keep up.
+		bool isDecodingAhead();
 
 		/// @brief Prepares the Buffer by pre-loaded meta-data and getting Sources ready to provide audio data.
 		void prepare();
 		/// @brief Prepares the Buffer by pre-loaded meta-data and getting Sources ready to provide audio data asynchronously.
 		/// @return True if the Buffer was queued successfully.
 		bool prepareAsync();
+		/// @brief Prepares a streamed Buffer and decodes the beginning of its data ahead of playback.
+		/// @param[in] size The number of bytes to decode.
+		/// @note The decoded data is handed out first by the following load() calls.
+		void preload(int size);
 		/// @brief Loads audio data from the Source.
 		/// @param[in] looping Whether the data should be loaded in a looped manner.
 		/// @param[in] size The maximum number of bytes to load.
@@ -82,11 +105,18 @@ namespace xal
 		/// @param[in] playerPaused Whether the player is currently paused.
 		/// @note Players are only truly unbound if they are not paused. This method also discards buffered data if no Players are bound to save memory (depends on the Buffer Mode).
 		void unbind(Player* player, bool playerPaused);
+		/// @brief Loads the meta-data without opening the Source for decoding.
+		void loadMetaData();
 		/// @brief Notifies the Buffer that it's being used.
 		void keepLoaded();
 		/// @brief Rewinds the Source to the beginning.
 		/// @note This affects the underlying audio data, not the data provided by the Buffer.
 		void rewind();
+		/// @brief Moves the Source of a streamed Buffer to a sample.
+		/// @param[in] samplePosition The sample to move to.
+		/// @return True if successful.
+		/// @note This affects the underlying audio data, not the data provided by the Buffer.
+		bool seek(int64_t samplePosition);
 
 		/// @brief Calculates the byte-size to which the data will be converted in the underlying audio system.
 		/// @param[in] size The byte-size of the actual data in this Buffer.
@@ -108,12 +138,41 @@ namespace xal
 		hstr filename;
 		/// @brief File size of the source.
 		int fileSize;
+		/// @brief Format of the source.
+		Format format;
+		/// @brief Whether the format was already checked against the magic bytes of the file data.
+		bool formatDetected;
 		/// @brief Buffer Mode to use.
 		BufferMode mode;
 		/// @brief Whether the underlying source was loaded.
 		bool loaded;
 		/// @brief Current data provided by the buffer.
 		hstream stream;
+		/// @brief Current data referenced directly from the Source's memory, used instead of the stream if not NULL.
+		unsigned char* directData;
+		/// @brief Byte-size of the directly referenced data.
+		int directDataSize;
+		/// @brief Data of a streamed Buffer decoded ahead of playback.
+		hstream preloadStream;
+		/// @brief How much of the preloaded data was already handed out.
+		int preloadPosition;
+		/// @brief Current sample position of a streamed Buffer's Source.
+		int64_t streamPosition;
+		/// @brief First sample of the loop.
+		int64_t loopStart;
+		/// @brief Sample at which the loop ends or 0 if the loop ends with the audio data.
+		int64_t loopEnd;
+		/// @brief Second Source of a streamed Buffer with loop points that is kept ready at the loop start.
+		/// @note The Sources are swapped when the loop restarts so the refill never has to seek. A RAM Source's data is shared.
+		Source* loopSource;
+		/// @brief Data from the loop start decoded ahead of time by the loop Source.
+		hstream loopStream;
+		/// @brief Size of the stream buffers of the Category, used for the data decoded ahead of time at the loop start.
+		int streamBufferSize;
+		/// @brief Whether the loop Source is positioned behind the decoded loop start data.
+		bool loopPrepared;
+		/// @brief Whether the loop Source has to be prepared in the next update.
+		bool loopRequested;
 		/// @brief Flag for whether an asynchronous load was queued.
 		bool asyncLoadQueued;
 		/// @brief Flag for whether asynchronously loaded data should be discarded.
@@ -139,15 +198,98 @@ namespace xal
 		harray<Player*> boundPlayers;
 		/// @brief How much time has passed since the last access of this buffer (in seconds).
 		float idleTime;
+		/// @brief Encoded file data kept in RAM by COMPRESSED Buffers if the file isn't in a sound bank.
+		hstream compressedData;
+		/// @brief How many times the Buffer's Sound was played, used for the decoded cache.
+		int playCount;
+		/// @brief Ring into which the stream decoder thread decodes the data of a fed streamed Buffer ahead of playback.
+		unsigned char* aheadData;
+		/// @brief Byte-size of the ring.
+		int aheadCapacity;
+		/// @brief Byte-size of the chunks decoded into the ring, the same as the Player's stream buffers.
+		int aheadChunkSize;
+		/// @brief Position of the first decoded byte in the ring.
+		int aheadStart;
+		/// @brief Byte-size of the decoded data in the ring.
+		int aheadSize;
+		/// @brief Whether the decoded data in the ring reaches the end of the audio data.
+		bool aheadEnded;
+		/// @brief Whether the data is decoded into the ring and load() only copies from it.
+		bool aheadActive;
+		/// @brief Whether the data is decoded into the ring in a looped manner.
+		bool aheadLooping;
+		/// @brief Data copied out of the ring by the last load().
+		unsigned char* aheadOutput;
+		/// @brief Byte-size of the data copied out of the ring by the last load().
+		int aheadOutputSize;
+		/// @brief Mutex for access of the ring.
+		/// @note The stream feeder thread only locks this one so it never waits for the decoding.
+		hmutex aheadMutex;
 		
 		/// @brief Updates the Buffer.
 		/// @param[in] timeDelta Time passed since the last update.
 		void _update(float timeDelta);
+		/// @brief Calculates how long it takes until the Buffer's memory can be cleared because it's idle.
+		/// @return The time in seconds or a negative value if the Buffer's memory isn't cleared when idle.
+		float _calcUpdateDelay();
 		/// @brief Tries to load meta-data from the Source.
 		void _tryLoadMetaData();
+		/// @brief Tries to load meta-data from the AudioManager's manifest.
+		void _tryLoadManifestMetaData();
+		/// @brief Detects the format from the first bytes of the file data once and recreates the Source if it differs.
+		/// @note Keeps the current format if the data isn't recognized. The Source must not be open.
+		void _tryDetectFormat();
+		/// @return The format based on the file extension.
+		Format _getFormatFromExtension();
+		/// @brief Loads audio data from the Source without locking.
+		/// @param[in] looping Whether the data should be loaded in a looped manner.
+		/// @param[in] size The maximum number of bytes to load.
+		/// @return The number of bytes read from the Source, not counting silence.
+		int _load(bool looping, int size);
+		/// @brief Copies the data decoded ahead from the ring.
+		/// @param[in] size The maximum number of bytes to copy.
+		/// @return The number of bytes copied.
+		int _loadAhead(int size);
+		/// @brief Starts decoding the data of a streamed Buffer ahead of playback into the ring.
+		/// @param[in] chunkSize Byte-size of the chunks that are decoded at once.
+		/// @param[in] chunkCount How many chunks fit into the ring.
+		/// @param[in] looping Whether the data is decoded in a looped manner.
+		/// @return True if the data is decoded ahead.
+		/// @note Not possible if the data has to be converted for the audio-system.
+		bool _startDecodeAhead(int chunkSize, int chunkCount, bool looping);
+		/// @brief Stops decoding ahead, handing out the data left in the ring first with the following load() calls.
+		void _stopDecodeAhead();
+		/// @brief Decodes one chunk into the ring if there is room.
+		/// @return True if anything was decoded.
+		/// @note This is called by the stream decoder thread.
+		bool _decodeAhead();
+		/// @brief Loads all data from the opened Source, referencing it directly if possible.
+		void _loadFromSource();
+		/// @brief Writes data from a streamed Buffer's Source into the stream, stopping at the loop end if looped.
+		/// @param[in] size The maximum number of bytes to write.
+		/// @param[in] looping Whether the data is loaded in a looped manner.
+		/// @return The number of bytes written.
+		int _loadChunk(int size, bool looping);
+		/// @brief Restarts the loop of a streamed Buffer by handing out the data decoded ahead of time by the loop Source.
+		/// @note The Source is only moved synchronously if the loop Source isn't prepared yet.
+		void _restartLoop();
+		/// @brief Positions the loop Source at the loop start and decodes the data following it.
+		void _prepareLoop();
+		/// @brief Destroys the loop Source, keeping the Source that owns the data of a RAM Source.
+		void _destroyLoopSource();
+		/// @brief Writes preloaded data into the stream.
+		/// @param[in] size The maximum number of bytes to write.
+		/// @return The number of bytes written.
+		int _loadPreloaded(int size);
+		/// @brief Keeps a reference to the seek index that the Source of a Player's Buffer built for the same file.
+		void _retainSeekIndex();
 		/// @brief Tries to free up memory.
 		/// @return True if any memory was freed.
 		bool _tryClearMemory();
+		/// @brief Gets the encoded file data of a COMPRESSED Buffer, reading it into RAM first if necessary.
+		/// @param[out] data The encoded file data or NULL if the file could not be read.
+		/// @param[out] dataSize Byte-size of the encoded file data.
+		void _getCompressedData(unsigned char** data, int64_t* dataSize);
 
 		/// @brief Loads the async data from the disk into a stream.
 		/// @return True if there is a stream ready. False if loading was canceled in the meantime.
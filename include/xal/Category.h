@@ -13,6 +13,7 @@
 #ifndef XAL_CATEGORY_H
 #define XAL_CATEGORY_H
 
+#include <hltypes/harray.h>
 #include <hltypes/hltypesUtil.h>
 #include <hltypes/hstring.h>
 
@@ -21,10 +22,15 @@
 
 namespace xal
 {
+	class SoundBank;
+
 	/// @brief Defines an audio category which makes audio file organization easier.
 	class xalExport Category
 	{
 	public:
+		friend class AudioManager;
+		friend class Player;
+
 		/// @brief Constructor.
 		/// @param[in] name Category name.
 		/// @param[in] bufferMode How to handle the intermediate Buffer of the Sound.
@@ -38,6 +44,21 @@ namespace xal
 		void setGain(float value);
 		HL_DEFINE_GET(BufferMode, bufferMode, BufferMode);
 		HL_DEFINE_GET(SourceMode, sourceMode, SourceMode);
+		HL_DEFINE_GET(harray<SoundBank*>, soundBanks, SoundBanks);
+		HL_DEFINE_GET(int, streamBufferCount, StreamBufferCount);
+		/// @brief Sets the number of buffers used by streamed Players.
+		/// @param[in] value The number of buffers, at least 2.
+		/// @note Only affects Players created afterwards.
+		void setStreamBufferCount(int value);
+		HL_DEFINE_GET(int, streamBufferSize, StreamBufferSize);
+		/// @brief Sets the byte-size of each buffer used by streamed Players.
+		/// @param[in] value The byte-size, rounded up to a power of 2 of at least 1024.
+		/// @note Only affects Players created afterwards.
+		void setStreamBufferSize(int value);
+		HL_DEFINE_ISSET(adaptiveStreamBuffering, AdaptiveStreamBuffering);
+		HL_DEFINE_GETSET(int, maxVoices, MaxVoices);
+		/// @return How many times streams of this Category ran dry.
+		HL_DEFINE_GET(int, underrunCount, UnderrunCount);
 		/// @return True if Sounds in this Category are streamed.
 		bool isStreamed();
 		/// @return True if Sounds in this Category have their data managed by the system.
@@ -52,6 +73,20 @@ namespace xal
 		BufferMode bufferMode;
 		/// @brief sourceMode How to handle the Source of the Sound.
 		SourceMode sourceMode;
+		/// @brief Sound banks from which the Sounds of this Category are read.
+		harray<SoundBank*> soundBanks;
+		/// @brief Number of buffers used by streamed Players.
+		int streamBufferCount;
+		/// @brief Byte-size of each buffer used by streamed Players.
+		int streamBufferSize;
+		/// @brief Whether streamed Players adapt the number of queued buffers to the measured refill timing.
+		/// @note The number of buffers stays between 2 and the stream buffer count.
+		bool adaptiveStreamBuffering;
+		/// @brief How many times streams of this Category ran dry.
+		int underrunCount;
+		/// @brief Maximum number of Players of this Category that use a voice of the audio-system at the same time, 0 for no limit.
+		/// @note Less important Players become virtual if the limit is exceeded.
+		int maxVoices;
 		
 	};
 
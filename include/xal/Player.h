@@ -32,6 +32,7 @@ namespace xal
 	{
 	public:
 		friend class AudioManager;
+		friend class StreamFeeder;
 
 		float getGain();
 		void setGain(float value);
@@ -47,6 +48,16 @@ namespace xal
 		float getTimePosition();
 		unsigned int getSamplePosition();
 		Category* getCategory();
+		/// @return How many times the stream ran dry and had to be restarted.
+		HL_DEFINE_GET(int, underrunCount, UnderrunCount);
+		/// @return How many stream buffers are currently kept queued.
+		HL_DEFINE_GET(int, queuedBufferCount, QueuedBufferCount);
+		/// @return Smoothed deviation of the time between stream refills in seconds.
+		HL_DEFINE_GET(float, refillJitter, RefillJitter);
+		/// @return Smoothed time needed to decode and queue a stream refill in seconds.
+		HL_DEFINE_GET(float, refillDuration, RefillDuration);
+		/// @return By how many output samples the last scheduled start missed its time, positive if it started late.
+		HL_DEFINE_GET(int64_t, scheduleError, ScheduleError);
 		
 		/// @return True if the Sound is playing.
 		/// @note This is false if the Sound is fading out even tough it is still "playing".
@@ -57,6 +68,11 @@ namespace xal
 		bool isFading();
 		bool isFadingIn();
 		bool isFadingOut();
+		/// @return True if the Sound is waiting for its scheduled start.
+		bool isScheduled();
+		/// @return True if the Sound plays without a voice of the audio-system because of voice limits or because it's inaudible.
+		/// @note The position of virtual Sounds keeps advancing and they get a voice again once one is available.
+		HL_DEFINE_IS(virtualized, Virtual);
 		HL_DEFINE_IS(looping, Looping);
 
 		/// @brief Starts playing the Sound.
@@ -69,6 +85,13 @@ namespace xal
 		/// @param[in] looping Whether the Sound should be looped once it is done playing.
 		/// @note Ignored if the Sound is already playing. Prevents pause/stop without pausing/stopping the Sound if called during fade-out.
 		void playAsync(float fadeTime = 0.0f, bool looping = false);
+		/// @brief Starts playing the Sound at a time of the output clock.
+		/// @param[in] outputSampleTime The output sample time at which to start.
+		/// @param[in] fadetime How long to fade-in the Sound.
+		/// @param[in] looping Whether the Sound should be looped once it is done playing.
+		/// @note The data is prepared when the time is within the AudioManager's schedule lookahead. Times in the past start the Sound immediately.
+		/// @see AudioManager::getOutputSampleTime
+		void playAt(int64_t outputSampleTime, float fadeTime = 0.0f, bool looping = false);
 		/// @brief Stops the Sound completely.
 		/// @param[in] fadetime How long to fade-out the Sound.
 		void stop(float fadeTime = 0.0f);
@@ -77,6 +100,19 @@ namespace xal
 		/// @note Unpause the Sound with play().
 		/// @see play
 		void pause(float fadeTime = 0.0f);
+		/// @brief Moves the playback position.
+		/// @param[in] timePosition The position in seconds.
+		/// @note Paused and stopped Sounds continue from this position when they are played.
+		/// @note Playing streamed Sounds are stopped for a moment while the queued data is replaced.
+		void seek(float timePosition);
+		/// @brief Moves the playback position.
+		/// @param[in] samplePosition The position in samples.
+		/// @note Paused and stopped Sounds continue from this position when they are played.
+		/// @note Playing streamed Sounds are stopped for a moment while the queued data is replaced.
+		void seekSample(unsigned int samplePosition);
+		/// @brief Prepares the Sound's data ahead of playback so play() can start without delay.
+		/// @note Streamed data is opened and decoded up to the size of the stream buffers, other data is loaded asynchronously.
+		void preload();
 
 	protected:
 		/// @brief The gain at which the Sound is played.
@@ -105,9 +141,51 @@ namespace xal
 		int bufferIndex;
 		/// @brief How many bytes have been processed during the last update.
 		int processedByteCount;
+		/// @brief Number of buffers used for streaming, taken from the Category upon creation.
+		int streamBufferCount;
+		/// @brief Byte-size of each buffer used for streaming, taken from the Category upon creation.
+		int streamBufferSize;
+		/// @brief Number of stream buffers kept queued, only changes with adaptive stream buffering.
+		int queuedBufferCount;
+		/// @brief How many times the stream ran dry.
+		int underrunCount;
+		/// @brief Smoothed time between stream refills.
+		float refillInterval;
+		/// @brief Smoothed deviation of the time between stream refills.
+		float refillJitter;
+		/// @brief Smoothed time needed for a stream refill.
+		float refillDuration;
+		/// @brief Time since the last stream refill.
+		float refillTime;
+		/// @brief Time since the number of queued stream buffers last had to change.
+		float refillStableTime;
+		/// @brief Whether the stream is refilled by the stream feeder thread instead of the update.
+		bool streamFed;
+		/// @brief Whether the stream ran out of data and the Player has to be stopped.
+		bool streamEnded;
+		/// @brief Whether the audio-system stopped the stream because it ran dry and it has to be restarted.
+		bool streamUnderrun;
 		/// @brief How long this Player has been idle.
 		/// @note Used for memory cleaning.
 		float idleTime;
+		/// @brief Sample position at which the voice starts when it's prepared the next time or -1 to start normally.
+		int seekPosition;
+		/// @brief Whether the Sound plays without a voice of the audio-system.
+		bool virtualized;
+		/// @brief Position in seconds while playing virtually.
+		float virtualPosition;
+		/// @brief Output sample time at which the virtual position was last advanced.
+		int64_t virtualClockTime;
+		/// @brief Output sample time of the scheduled start or -1 if no start is scheduled.
+		int64_t scheduledTime;
+		/// @brief Fade-in time of the scheduled start.
+		float scheduledFadeTime;
+		/// @brief Whether the scheduled start is looped.
+		bool scheduledLooping;
+		/// @brief Whether the data for the scheduled start is already prepared.
+		bool scheduledPrepared;
+		/// @brief By how many output samples the last scheduled start missed its time.
+		int64_t scheduleError;
 		/// @brief Flag whether async playing was queued.
 		bool asyncPlayQueued;
 		/// @brief Mutex for access of async playing flag.
@@ -131,6 +209,8 @@ namespace xal
 		/// @retunr True if the Sound is playing or is asynchronously queued for playing.
 		/// @note This method is not thread-safe and is for internal usage only.
 		bool _isPlaying();
+		/// @note This method is not thread-safe and is for internal usage only. It locks StreamFeeder::mutex for streamed Players.
+		unsigned int _getSamplePosition();
 		/// @brief Returns whether the Player is waiting to be played after an asynchronous buffer load.
 		/// @retunr True if the Player is waiting to be played after an asynchronous buffer load.
 		/// @note This method is not thread-safe and is for internal usage only.
@@ -146,12 +226,77 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _playAsync(float fadeTime = 0.0f, bool looping = false);
 		/// @note This method is not thread-safe and is for internal usage only.
+		void _playAt(int64_t outputSampleTime, float fadeTime = 0.0f, bool looping = false);
+		/// @brief Prepares and starts a scheduled Sound once the output clock gets close enough.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _updateSchedule();
+		/// @brief Does everything needed to start playing except actually starting the audio-system's voice.
+		/// @param[in] fadetime How long to fade-in the Sound.
+		/// @param[in] looping Whether the Sound should be looped once it is done playing.
+		/// @return True if the Player can be started.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _preparePlay(float fadeTime, bool looping);
+		/// @brief Prepares the Buffer and the audio-system's voice with the data.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _prepareBuffer();
+		/// @brief Starts playing without a voice of the audio-system.
+		/// @param[in] fadetime How long to fade-in the Sound.
+		/// @param[in] looping Whether the Sound should be looped once it is done playing.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _playVirtual(float fadeTime, bool looping);
+		/// @brief Gives up the voice of the audio-system and keeps playing virtually.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _virtualize();
+		/// @brief Gets a voice of the audio-system again after playing virtually.
+		/// @return True if the audio-system had a voice available.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _promote();
+		/// @brief Advances the virtual position by the time passed on the output clock.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _updateVirtualPosition();
+		/// @brief Compares the importance of two Players for voice stealing.
+		/// @param[in] other The other Player.
+		/// @return True if this Player is less important than the other one.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _isLessImportant(Player* other);
+		/// @note This method is not thread-safe and is for internal usage only.
 		void _stop(float fadeTime = 0.0f);
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _pause(float fadeTime = 0.0f);
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _preload();
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _seek(unsigned int samplePosition);
 
 		/// @return The current gain for the Sound depending on global gain, category gain and Player gain.
 		float _calcGain();
+		/// @brief Calculates how long it takes until the Player needs to be updated again.
+		/// @return The time in seconds or a negative value if the Player has no pending work.
+		/// @note This method is not thread-safe and is for internal usage only.
+		virtual float _calcUpdateDelay();
+		/// @brief Calculates how long it takes until a scheduled start needs to be prepared or started.
+		/// @return The time in seconds or a negative value if no start is scheduled.
+		/// @note This method is not thread-safe and is for internal usage only.
+		float _calcScheduleDelay();
+		/// @brief Calculates how long it takes until the stream needs to be refilled again.
+		/// @return The time in seconds.
+		/// @note This method is not thread-safe and is for internal usage only.
+		float _calcFeedDelay();
+		/// @brief Refills the stream on the stream feeder thread.
+		/// @param[in] timeDelta Time since the last refill.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _feedStream(float timeDelta);
+		/// @brief Restarts a stream that was stopped by the audio-system because it ran dry.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _restartStream();
+		/// @brief Counts an underrun and queues more stream buffers if adaptive stream buffering is used.
+		/// @note This is called by the audio-system when it has to restart a stream that ran dry.
+		void _registerUnderrun();
+		/// @brief Measures the stream refill timing and adapts the number of queued stream buffers.
+		/// @param[in] timeDelta Time since the last update.
+		/// @param[in] duration How long the stream update took.
+		/// @param[in] refilled Whether the stream was refilled in this update.
+		void _updateStreamBuffering(float timeDelta, float duration, bool refilled);
 
 		/// @brief Whether the Sound is actually playing.
 		/// @note This is implemented by the audio-system.
@@ -181,9 +326,19 @@ namespace xal
 		/// @brief Updates the current pitch of the Player in the audio-system.
 		/// @note This is implemented by the audio-system.
 		inline virtual void _systemUpdatePitch() { }
+		/// @brief Repositions playback in the audio-system.
+		/// @param[in] samplePosition The sample position.
+		/// @return True if the audio-system supports seeking.
+		/// @note This is implemented by the audio-system. The Buffer of streamed Sounds is already repositioned so any queued data has to be discarded and filled again. Voices that can't replace queued data while playing are stopped and restarted, the new data should be decoded before that to keep the gap short.
+		inline virtual bool _systemSeek(unsigned int samplePosition) { return false; }
 		/// @brief Starts playback in the audio-system.
 		/// @note This is implemented by the audio-system.
 		inline virtual void _systemPlay() { }
+		/// @brief Makes the audio-system delay the following _systemPlay() until a time of the output clock.
+		/// @param[in] outputSampleTime The output sample time at which to start.
+		/// @return True if the audio-system starts the voice at that time by itself.
+		/// @note This is implemented by the audio-system.
+		inline virtual bool _systemSetStartTime(int64_t outputSampleTime) { return false; }
 		/// @brief Stops playback in the audio-system.
 		/// @return How many bytes have been played since the last update.
 		/// @note This is implemented by the audio-system.
@@ -191,6 +346,13 @@ namespace xal
 		/// @brief Updates non-streaming processing in non-streamed Sounds.
 		/// @note This is implemented by the audio-system.
 		inline virtual void _systemUpdateNormal() { }
+		/// @return True if the audio-system's streams can be refilled by the stream feeder thread.
+		/// @note This is implemented by the audio-system.
+		inline virtual bool _systemSupportsStreamFeeding() { return false; }
+		/// @brief Refills the stream without changing the Player's state.
+		/// @return How many bytes have been played since the last refill.
+		/// @note This is implemented by the audio-system. The end of the stream and underruns are only reported through streamEnded and streamUnderrun.
+		inline virtual int _systemFeedStream() { return 0; }
 		/// @brief Updates streaming processing in streamed Sounds.
 		/// @return How many bytes have been played since the last update.
 		/// @note This is implemented by the audio-system.
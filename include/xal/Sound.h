@@ -40,6 +40,8 @@ namespace xal
 		HL_DEFINE_GET(hstr, filename, Filename);
 		HL_DEFINE_GET(Category*, category, Category);
 		HL_DEFINE_GET(Buffer*, buffer, Buffer);
+		HL_DEFINE_GETSET(int, maxInstances, MaxInstances);
+		HL_DEFINE_GETSET(int, priority, Priority);
 
 		/// @return Byte-size of the audio data.
 		int getSize();
@@ -74,6 +76,10 @@ namespace xal
 		Category* category;
 		/// @brief Buffer instance that handles decoded data.
 		Buffer* buffer;
+		/// @brief Maximum number of Players of this Sound that use a voice of the audio-system at the same time, 0 for no limit.
+		int maxInstances;
+		/// @brief Importance of the Sound when voices are limited, Players of less important Sounds become virtual first.
+		int priority;
 
 	};
 
@@ -13,7 +13,9 @@
 #ifndef XAL_SOURCE_H
 #define XAL_SOURCE_H
 
+#include <hltypes/harray.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
 #include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 
@@ -23,11 +25,25 @@
 namespace xal
 {
 	class Category;
+	class FileMapping;
+
+	/// @brief Read-only view of file data in memory with its own read position.
+	struct MemoryView
+	{
+		/// @brief The data.
+		unsigned char* data;
+		/// @brief Byte-size of the data.
+		int64_t size;
+		/// @brief Current read position.
+		int64_t position;
+	};
 
 	/// @brief Represents an audio data source.
 	class xalExport Source
 	{
 	public:
+		friend class Buffer;
+
 		/// @brief Constructor.
 		/// @param[in] filename Filename of the Source.
 		/// @param[in] sourceMode The Source's behavior mode.
@@ -45,15 +61,29 @@ namespace xal
 		HL_DEFINE_GET(int, samplingRate, SamplingRate);
 		HL_DEFINE_GET(int, bitsPerSample, BitsPerSample);
 		HL_DEFINE_GET(float, duration, Duration);
+		/// @return First sample of the loop.
+		HL_DEFINE_GET(int64_t, loopStart, LoopStart);
+		/// @return Sample at which the loop ends or 0 if the loop ends with the audio data.
+		HL_DEFINE_GET(int64_t, loopEnd, LoopEnd);
 		int getRamSize();
 
 		/// @brief Opens the Source for reading.
 		/// @return True if Source was opened successfully.
 		virtual bool open();
+		/// @brief Reads only the meta-data of the audio data without opening the Source for decoding.
+		/// @return True if the meta-data was read successfully.
+		/// @note If opening would copy the whole file into RAM, only _readMetaData() is used on the file. Otherwise or if
+		/// that fails, the Source is opened and closed.
+		virtual bool probe();
 		/// @brief Closes the Source.
 		virtual void close();
 		/// @brief Rewinds the Source's audio data to the beginning.
 		virtual void rewind();
+		/// @brief Moves the Source's audio data to a sample.
+		/// @param[in] samplePosition The sample to move to.
+		/// @return True if successful.
+		/// @note The default implementation rewinds and decodes everything up to the sample.
+		virtual bool seek(int64_t samplePosition);
 		/// @brief Loads all audio data.
 		/// @param[out] output Data stream where all data will be stored.
 		/// @return True if data was successfully read.
@@ -83,8 +113,62 @@ namespace xal
 		int bitsPerSample;
 		/// @brief Length of the audio data in seconds.
 		float duration;
+		/// @brief First sample of the loop.
+		int64_t loopStart;
+		/// @brief Sample at which the loop ends or 0 if the loop ends with the audio data.
+		int64_t loopEnd;
 		/// @brief The underlying audio data.
 		hsbase* stream;
+		/// @brief File data in memory that is used instead of the stream if available.
+		/// @note The memory is not owned by the Source (e.g. it's a slice of a sound bank).
+		MemoryView memory;
+		/// @brief Shared mapping of the file when the MMAP Source Mode is used.
+		FileMapping* mapping;
+
+		/// @brief Reads the meta-data from the file headers at the current position of the stream or memory.
+		/// @return True if the data is in a supported format.
+		/// @note The default implementation reads nothing, formats that can parse their headers without a decoder override it.
+		virtual bool _readMetaData() { return false; }
+		/// @brief Sets the memory from which the file data is read instead of opening the file.
+		/// @param[in] data The file data.
+		/// @param[in] size Byte-size of the file data.
+		void _setMemory(unsigned char* data, int64_t size);
+		/// @brief Reads raw file data from the stream or memory.
+		/// @param[out] buffer Where to store the data.
+		/// @param[in] count Maximum number of bytes to read.
+		/// @return Number of bytes read.
+		int _readRaw(void* buffer, int count);
+		/// @brief Seeks in the stream or memory.
+		/// @param[in] offset Offset to seek.
+		/// @param[in] seekMode From where to seek.
+		void _seek(int64_t offset, hsbase::SeekMode seekMode = hsbase::CURRENT);
+		/// @brief Reads the loop points from LOOPSTART, LOOPEND and LOOPLENGTH comments.
+		/// @param[in] comments The comments in the form of "NAME=value".
+		void _readLoopComments(harray<hstr> comments);
+		/// @return Current position in the stream or memory.
+		int64_t _getPosition();
+		/// @return True if the end of the stream or memory has been reached.
+		bool _isEof();
+		/// @brief Gets the file data at the current position if the whole file is in memory.
+		/// @param[out] available Number of bytes available from the current position.
+		/// @return The file data at the current position or NULL if the file is not in memory.
+		/// @note Only memory that remains valid after closing is provided.
+		unsigned char* _getMemoryData(int64_t* available);
+		/// @brief Provides all audio data without copying it if it's available in memory as PCM.
+		/// @param[out] data The audio data.
+		/// @param[out] size Byte-size of the audio data.
+		/// @return True if the data is available.
+		/// @note The data remains valid as long as the Source exists.
+		virtual bool _loadDirect(unsigned char** data, int* size) { return false; }
+		/// @brief Provides a chunk of audio data without copying it if it's available in memory as PCM.
+		/// @param[out] data The audio data.
+		/// @param[in] size Byte-size of the chunk.
+		/// @return True if the whole chunk is available.
+		/// @note The data remains valid as long as the Source exists.
+		virtual bool _loadChunkDirect(unsigned char** data, int size) { return false; }
+		/// @brief Keeps a reference to the seek index that another Source of the same file built so it isn't built again.
+		/// @note The reference is released when the Source is destroyed. Formats without a seek index do nothing.
+		virtual void _retainSeekIndex() { }
 
 	};
 
@@ -24,7 +24,10 @@
 #include "NoAudio_AudioManager.h"
 #include "Player.h"
 #include "Sound.h"
+#include "SoundBank.h"
 #include "Source.h"
+#include "StreamFeeder.h"
+#include "UpdateEvent.h"
 #include "xal.h"
 
 #ifdef _FORMAT_FLAC
@@ -33,6 +36,9 @@
 #ifdef _FORMAT_OGG
 #include "OGG_Source.h"
 #endif
+#ifdef _FORMAT_OPUS
+#include "OPUS_Source.h"
+#endif
 #ifdef _FORMAT_SPX
 #include "SPX_Source.h"
 #endif
@@ -40,14 +46,48 @@
 #include "WAV_Source.h"
 #endif
 
+// while Players are playing, the update thread wakes up at least this often in seconds
+#define MAX_UPDATE_DELAY 1.0f
+
 namespace xal
 {
 	extern void (*gLogFunction)(chstr);
 	
 	AudioManager* manager = NULL;
 
+	// identifies the binary layout of meta-data manifest files
+	static hstr _manifestHeader = "XALMETA1";
+
+	/// @return The earlier of two update delays where a negative value means that no update is needed.
+	static float _earlierUpdateDelay(float delay, float other)
+	{
+		if (other < 0.0f)
+		{
+			return delay;
+		}
+		return (delay < 0.0f ? other : hmin(delay, other));
+	}
+
+	static harray<Buffer*> _metaDataBuffers;
+	static hmutex _metaDataBuffersMutex;
+
+	static void _loadQueuedMetaData(hthread* thread)
+	{
+		Buffer* buffer = NULL;
+		hmutex::ScopeLock lock(&_metaDataBuffersMutex);
+		while (_metaDataBuffers.size() > 0)
+		{
+			buffer = _metaDataBuffers.removeFirst();
+			lock.release();
+			buffer->loadMetaData();
+			lock.acquire(&_metaDataBuffersMutex);
+		}
+	}
+
 	AudioManager::AudioManager(void* backendId, bool threaded, float updateTime, chstr deviceName) :
-		enabled(false), suspended(false), idlePlayerUnloadTime(60.0f), globalGain(1.0f), thread(NULL), threadRunning(false)
+		enabled(false), suspended(false), idlePlayerUnloadTime(60.0f), parallelDecoding(false), streamFeeding(false), streamFeederRealTime(false),
+		streamFeederCpuAffinity(0), maxVoices(0), systemVoiceLimit(0), scheduleLookahead(0.1f), decodedCacheSize(16777216), decodedCachePlayCount(2),
+		globalGain(1.0f), thread(NULL), threadRunning(false), updateEvent(NULL)
 	{
 		this->samplingRate = 44100;
 		this->channels = 2;
@@ -55,12 +95,16 @@ namespace xal
 		this->backendId = backendId;
 		this->deviceName = deviceName;
 		this->updateTime = updateTime;
+		this->clockStartTime = htickCount();
 #ifdef _FORMAT_FLAC
 		this->extensions += ".flac";
 #endif
 #ifdef _FORMAT_OGG
 		this->extensions += ".ogg";
 #endif
+#ifdef _FORMAT_OPUS
+		this->extensions += ".opus";
+#endif
 #ifdef _FORMAT_SPX
 		this->extensions += ".spx";
 #endif
@@ -70,6 +114,7 @@ namespace xal
 		if (threaded)
 		{
 			this->thread = new hthread(&AudioManager::_update, "XAL update");
+			this->updateEvent = new UpdateEvent();
 		}
 	}
 
@@ -79,6 +124,10 @@ namespace xal
 		{
 			delete this->thread;
 		}
+		if (this->updateEvent != NULL)
+		{
+			delete this->updateEvent;
+		}
 	}
 
 	void AudioManager::init()
@@ -95,6 +144,10 @@ namespace xal
 		hlog::write(xal::logTag, "Starting audio update thread.");
 		this->threadRunning = true;
 		this->thread->start();
+		if (this->streamFeeding)
+		{
+			StreamFeeder::start(this->streamFeederRealTime, this->streamFeederCpuAffinity);
+		}
 	}
 
 	void AudioManager::clear()
@@ -104,10 +157,12 @@ namespace xal
 		{
 			hlog::write(xal::logTag, "Stopping audio update thread.");
 			this->threadRunning = false;
+			this->_wakeUpdate();
 			lock.release();
 			this->thread->join();
 			lock.acquire(&this->mutex);
 		}
+		StreamFeeder::stop();
 		if (this->thread != NULL)
 		{
 			delete this->thread;
@@ -146,6 +201,8 @@ namespace xal
 		{
 			(*it)->_systemUpdateGain();
 		}
+		// audibility decides which Players are virtual
+		this->_wakeUpdate();
 	}
 
 	harray<Player*> AudioManager::getPlayers()
@@ -173,13 +230,69 @@ namespace xal
 	void AudioManager::_update(hthread* thread)
 	{
 		hmutex::ScopeLock lock;
+		int64_t lastTime = htickCount();
+		int64_t time = 0;
+		float delay = 0.0f;
 		while (xal::manager->thread != NULL && xal::manager->threadRunning)
 		{
 			lock.acquire(&xal::manager->mutex);
-			xal::manager->_update(xal::manager->updateTime);
+			time = htickCount();
+			xal::manager->_update((time - lastTime) * 0.001f);
+			lastTime = time;
+			delay = xal::manager->_calcUpdateDelay();
 			lock.release();
-			hthread::sleep(xal::manager->updateTime * 1000);
+			// sleeps until the next Player or Buffer needs to be updated or until a Player's state changes
+			xal::manager->updateEvent->wait(delay);
+		}
+	}
+
+	float AudioManager::_calcUpdateDelay()
+	{
+		if (!this->enabled || this->suspended)
+		{
+			return -1.0f;
+		}
+		float delay = -1.0f;
+		float scheduleDelay = -1.0f;
+		foreach (Player*, it, this->players)
+		{
+			delay = _earlierUpdateDelay(delay, (*it)->_calcUpdateDelay());
+			scheduleDelay = _earlierUpdateDelay(scheduleDelay, (*it)->_calcScheduleDelay());
+		}
+		if (delay >= 0.0f)
+		{
+			delay = hmin(delay, MAX_UPDATE_DELAY);
+		}
+		foreach (Buffer*, it, this->buffers)
+		{
+			delay = _earlierUpdateDelay(delay, (*it)->_calcUpdateDelay());
+		}
+		// updates never happen more often than the configured update time
+		if (delay >= 0.0f)
+		{
+			delay = hmax(delay, this->updateTime);
 		}
+		// except for scheduled starts which would otherwise be delayed by it
+		return _earlierUpdateDelay(delay, scheduleDelay);
+	}
+
+	void AudioManager::_wakeUpdate()
+	{
+		if (this->updateEvent != NULL)
+		{
+			this->updateEvent->signal();
+		}
+	}
+
+	int64_t AudioManager::getOutputSampleTime()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->_getOutputSampleTime();
+	}
+
+	int64_t AudioManager::_getOutputSampleTime()
+	{
+		return ((htickCount() - this->clockStartTime) * this->samplingRate / 1000);
 	}
 
 	void AudioManager::update(float timeDelta)
@@ -198,6 +311,10 @@ namespace xal
 			BufferAsync::update();
 			foreach (Player*, it, this->players)
 			{
+				if ((*it)->_calcUpdateDelay() < 0.0f) // nothing to do, e.g. stopped or paused
+				{
+					continue;
+				}
 				(*it)->_update(timeDelta);
 				if ((*it)->_isAsyncPlayQueued())
 				{
@@ -213,6 +330,7 @@ namespace xal
 					this->_destroyManagedPlayer(*it);
 				}
 			}
+			this->_updateVirtualVoices();
 			foreach (Buffer*, it, this->buffers)
 			{
 				(*it)->_update(timeDelta);
@@ -220,6 +338,122 @@ namespace xal
 		}
 	}
 
+	harray<Player*> AudioManager::_getVoices(Player* except)
+	{
+		harray<Player*> result;
+		foreach (Player*, it, this->players)
+		{
+			if ((*it) != except && !(*it)->virtualized && (*it)->_systemIsPlaying())
+			{
+				result += (*it);
+			}
+		}
+		return result;
+	}
+
+	bool AudioManager::_acquireVoice(Player* player)
+	{
+		harray<Player*> voices = this->_getVoices(player);
+		// once voices were released the audio-system is probed again since running out of voices might have been temporary
+		if (this->systemVoiceLimit > 0 && voices.size() < this->systemVoiceLimit)
+		{
+			this->systemVoiceLimit = 0;
+		}
+		int limit = this->maxVoices;
+		if (this->systemVoiceLimit > 0)
+		{
+			limit = (limit > 0 ? hmin(limit, this->systemVoiceLimit) : this->systemVoiceLimit);
+		}
+		Sound* sound = player->getSound();
+		return (this->_reserveVoice(player, voices, sound->getMaxInstances(), sound, NULL) &&
+			this->_reserveVoice(player, voices, sound->getCategory()->getMaxVoices(), NULL, sound->getCategory()) &&
+			this->_reserveVoice(player, voices, limit, NULL, NULL));
+	}
+
+	bool AudioManager::_reserveVoice(Player* player, harray<Player*>& voices, int limit, Sound* sound, Category* category)
+	{
+		if (limit <= 0)
+		{
+			return true;
+		}
+		harray<Player*> competitors;
+		foreach (Player*, it, voices)
+		{
+			if ((sound == NULL || (*it)->getSound() == sound) && (category == NULL || (*it)->getSound()->getCategory() == category))
+			{
+				competitors += (*it);
+			}
+		}
+		if (competitors.size() < limit)
+		{
+			return true;
+		}
+		// the least important Player gives up its voice
+		Player* victim = NULL;
+		foreach (Player*, it, competitors)
+		{
+			if ((*it)->_isLessImportant(victim != NULL ? victim : player))
+			{
+				victim = (*it);
+			}
+		}
+		if (victim == NULL)
+		{
+			return false;
+		}
+		victim->_virtualize();
+		voices /= victim;
+		return true;
+	}
+
+	void AudioManager::_registerSystemVoiceLimit()
+	{
+		int count = this->_getVoices().size();
+		if (count > 0)
+		{
+			this->systemVoiceLimit = count;
+			hlog::debugf(xal::logTag, "Audio-system ran out of voices at %d voices.", count);
+		}
+	}
+
+	void AudioManager::_updateVirtualVoices()
+	{
+		harray<Player*> candidates;
+		foreach (Player*, it, this->players)
+		{
+			if ((*it)->virtualized)
+			{
+				if ((*it)->_calcGain() > 0.0f)
+				{
+					candidates += (*it);
+				}
+			}
+			// inaudible Players don't need a voice
+			else if (!(*it)->paused && !(*it)->isFading() && (*it)->_calcGain() <= 0.0f && (*it)->_systemIsPlaying())
+			{
+				(*it)->_virtualize();
+			}
+		}
+		Player* player = NULL;
+		while (candidates.size() > 0)
+		{
+			player = candidates.first();
+			foreach (Player*, it, candidates)
+			{
+				if (player->_isLessImportant(*it))
+				{
+					player = (*it);
+				}
+			}
+			candidates /= player;
+			if (this->_acquireVoice(player) && !player->_promote())
+			{
+				this->_registerSystemVoiceLimit();
+				break;
+			}
+		}
+	}
+
 	Category* AudioManager::createCategory(chstr name, BufferMode bufferMode, SourceMode sourceMode)
 	{
 		hmutex::ScopeLock lock(&this->mutex);
@@ -403,6 +637,176 @@ namespace xal
 		return result;
 	}
 
+	harray<hstr> AudioManager::createSoundsFromSoundBank(chstr filename, chstr categoryName, chstr prefix)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->_createSoundsFromSoundBank(filename, categoryName, prefix);
+	}
+
+	harray<hstr> AudioManager::_createSoundsFromSoundBank(chstr filename, chstr categoryName, chstr prefix)
+	{
+		harray<hstr> result;
+		SoundBank* soundBank = new SoundBank(filename);
+		if (!soundBank->open())
+		{
+			delete soundBank;
+			return result;
+		}
+		Category* category = this->_createCategory(categoryName, FULL, DISK);
+		category->soundBanks += soundBank;
+		harray<hstr> files = soundBank->getFilenames();
+		Sound* sound;
+		foreach (hstr, it, files)
+		{
+			sound = this->_createSound((*it), categoryName, prefix);
+			if (sound != NULL)
+			{
+				result += sound->getName();
+			}
+		}
+		return result;
+	}
+
+	bool AudioManager::packSoundBank(chstr filename, chstr path)
+	{
+		harray<hstr> files;
+		harray<hstr> allFiles = hrdir::files(path, true);
+		foreach (hstr, it, allFiles)
+		{
+			foreach (hstr, it2, this->extensions)
+			{
+				if ((*it).lowered().endsWith(*it2))
+				{
+					files += (*it);
+					break;
+				}
+			}
+		}
+		return SoundBank::pack(filename, path, files);
+	}
+
+	void AudioManager::loadMetaData(harray<hstr> soundNames)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->_loadMetaData(soundNames);
+	}
+
+	void AudioManager::_loadMetaData(harray<hstr> soundNames)
+	{
+		harray<Buffer*> buffers;
+		foreach (hstr, it, soundNames)
+		{
+			if (this->sounds.hasKey(*it))
+			{
+				buffers += this->sounds[*it]->getBuffer();
+			}
+		}
+		if (buffers.size() == 0)
+		{
+			return;
+		}
+		hmutex::ScopeLock lock(&_metaDataBuffersMutex);
+		_metaDataBuffers += buffers;
+		lock.release();
+		// the current thread works on the queue as well
+		harray<hthread*> threads;
+		int count = hmin(BufferAsync::getCpuCount(), buffers.size());
+		for_iter (i, 1, count)
+		{
+			threads += new hthread(&_loadQueuedMetaData, "XAL meta-data loader");
+			threads.last()->start();
+		}
+		_loadQueuedMetaData(NULL);
+		foreach (hthread*, it, threads)
+		{
+			(*it)->join();
+			delete (*it);
+		}
+	}
+
+	bool AudioManager::loadMetaDataManifest(chstr filename)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->_loadMetaDataManifest(filename);
+	}
+
+	bool AudioManager::_loadMetaDataManifest(chstr filename)
+	{
+		if (!hresource::exists(filename))
+		{
+			hlog::error(xal::logTag, "Unable to open manifest: " + filename);
+			return false;
+		}
+		hresource file;
+		file.open(filename);
+		if (file.loadString() != _manifestHeader)
+		{
+			hlog::error(xal::logTag, "Unsupported manifest: " + filename);
+			return false;
+		}
+		hstr name;
+		ManifestEntry entry;
+		int count = file.loadInt32();
+		for_iter (i, 0, count)
+		{
+			name = file.loadString();
+			entry.modificationTime = file.loadInt64();
+			entry.fileSize = file.loadInt32();
+			entry.format = (Format)file.loadUint8();
+			entry.size = file.loadInt32();
+			entry.channels = file.loadInt32();
+			entry.samplingRate = file.loadInt32();
+			entry.bitsPerSample = file.loadInt32();
+			entry.duration = file.loadFloat();
+			this->manifest[name] = entry;
+		}
+		hlog::debugf(xal::logTag, "Loaded manifest with %d entries: %s", count, filename.cStr());
+		return true;
+	}
+
+	bool AudioManager::saveMetaDataManifest(chstr filename)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->_saveMetaDataManifest(filename);
+	}
+
+	bool AudioManager::_saveMetaDataManifest(chstr filename)
+	{
+		this->_loadMetaData(this->sounds.keys());
+		harray<Buffer*> buffers;
+		foreach_m (Sound*, it, this->sounds)
+		{
+			if (it->second->getFormat() != UNKNOWN)
+			{
+				buffers |= it->second->getBuffer();
+			}
+		}
+		hfile file;
+		file.open(filename, hfile::WRITE);
+		if (!file.isOpen())
+		{
+			hlog::error(xal::logTag, "Unable to write manifest: " + filename);
+			return false;
+		}
+		file.dump(_manifestHeader);
+		file.dump(buffers.size());
+		foreach (Buffer*, it, buffers)
+		{
+			file.dump((*it)->filename);
+			file.dump((int64_t)hresource::hinfo((*it)->filename).modificationTime);
+			file.dump((*it)->fileSize);
+			file.dump((unsigned char)(*it)->getFormat());
+			file.dump((*it)->getSize());
+			file.dump((*it)->getChannels());
+			file.dump((*it)->getSamplingRate());
+			file.dump((*it)->getBitsPerSample());
+			file.dump((*it)->getDuration());
+		}
+		file.close();
+		hlog::debugf(xal::logTag, "Saved manifest with %d entries: %s", buffers.size(), filename.cStr());
+		return true;
+	}
+
 	bool AudioManager::hasSound(chstr name)
 	{
 		return this->sounds.hasKey(name);
@@ -452,9 +856,9 @@ namespace xal
 		this->_destroyPlayer(player);
 	}
 
-	Buffer* AudioManager::_createBuffer(Sound* sound)
+	Buffer* AudioManager::_createBuffer(Sound* sound, Buffer* compressedBuffer)
 	{
-		Buffer* buffer = new Buffer(sound);
+		Buffer* buffer = new Buffer(sound, compressedBuffer);
 		this->buffers += buffer;
 		return buffer;
 	}
@@ -462,9 +866,62 @@ namespace xal
 	void AudioManager::_destroyBuffer(Buffer* buffer)
 	{
 		this->buffers -= buffer;
+		this->decodedBuffers /= buffer;
 		delete buffer;
 	}
 
+	void AudioManager::_registerCompressedPlay(Buffer* buffer)
+	{
+		++buffer->playCount;
+		// Buffers that were cleared in the meantime don't occupy the cache anymore
+		harray<Buffer*> decodedBuffers = this->decodedBuffers;
+		foreach (Buffer*, it, decodedBuffers)
+		{
+			if (!(*it)->isLoaded() && !(*it)->isAsyncLoadQueued())
+			{
+				this->decodedBuffers -= (*it);
+			}
+		}
+		if (this->decodedBuffers.has(buffer) || buffer->playCount < this->decodedCachePlayCount)
+		{
+			return;
+		}
+		int size = buffer->getSize();
+		if (size > this->decodedCacheSize)
+		{
+			return;
+		}
+		int cachedSize = 0;
+		foreach (Buffer*, it, this->decodedBuffers)
+		{
+			cachedSize += (*it)->getSize();
+		}
+		Buffer* evicted = NULL;
+		while (cachedSize + size > this->decodedCacheSize)
+		{
+			// the least frequently played Buffer that isn't in use is evicted first
+			evicted = NULL;
+			foreach (Buffer*, it, this->decodedBuffers)
+			{
+				if ((*it)->playCount < buffer->playCount && (evicted == NULL || (*it)->playCount < evicted->playCount) && (*it)->boundPlayers.size() == 0)
+				{
+					evicted = (*it);
+				}
+			}
+			if (evicted == NULL || !evicted->_tryClearMemory())
+			{
+				return;
+			}
+			this->decodedBuffers -= evicted;
+			cachedSize -= evicted->getSize();
+		}
+		this->decodedBuffers += buffer;
+		if (!buffer->isLoaded())
+		{
+			buffer->prepareAsync();
+		}
+	}
+
 	Source* AudioManager::_createSource(chstr filename, SourceMode sourceMode, BufferMode bufferMode, Format format)
 	{
 		Source* source;
@@ -480,6 +937,11 @@ namespace xal
 			source = new OGG_Source(filename, sourceMode, bufferMode);
 			break;
 #endif
+#ifdef _FORMAT_OPUS
+		case OPUS:
+			source = new OPUS_Source(filename, sourceMode, bufferMode);
+			break;
+#endif
 #ifdef _FORMAT_SPX
 		case SPX:
 			source = new SPX_Source(filename, sourceMode, bufferMode);
@@ -531,6 +993,93 @@ namespace xal
 		player->_playAsync(fadeTime, looping);
 	}
 
+	void AudioManager::playGroup(harray<Player*> players, float fadeTime, bool looping)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->_playGroup(players, fadeTime, looping);
+	}
+
+	void AudioManager::_playGroup(harray<Player*> players, float fadeTime, bool looping)
+	{
+		if (!this->enabled)
+		{
+			return;
+		}
+		if (this->suspended)
+		{
+			foreach (Player*, it, players)
+			{
+				(*it)->_play(fadeTime, looping);
+			}
+			return;
+		}
+		// voice stealing may remove Players from the stream feeder so voices have to be acquired first
+		harray<Player*> voiced;
+		foreach (Player*, it, players)
+		{
+			if ((*it)->virtualized)
+			{
+				(*it)->_play(fadeTime, looping);
+			}
+			else if ((*it)->isFading() || (*it)->_systemIsPlaying() || this->_acquireVoice(*it))
+			{
+				voiced += (*it);
+			}
+			else
+			{
+				(*it)->_playVirtual(fadeTime, looping);
+			}
+		}
+		// the stream feeder thread must not access any of the streams while they are being set up
+		hmutex::ScopeLock streamLock(&StreamFeeder::mutex);
+		harray<Player*> prepared;
+		harray<Player*> starting;
+		bool alreadyFading = false;
+		foreach (Player*, it, voiced)
+		{
+			alreadyFading = (*it)->isFading();
+			if (!alreadyFading && (*it)->_systemIsPlaying())
+			{
+				continue;
+			}
+			if ((*it)->_preparePlay(fadeTime, looping))
+			{
+				prepared += (*it);
+				if (!alreadyFading)
+				{
+					starting += (*it);
+				}
+			}
+		}
+		if (starting.size() > 0)
+		{
+			this->_systemPlayGroup(starting);
+		}
+		foreach (Player*, it, prepared)
+		{
+			(*it)->paused = false;
+			if ((*it)->buffer->isStreamed())
+			{
+				StreamFeeder::_addPlayer(*it);
+			}
+		}
+		streamLock.release();
+		foreach (Player*, it, prepared)
+		{
+			hmutex::ScopeLock lock(&(*it)->asyncPlayMutex);
+			(*it)->asyncPlayQueued = false;
+		}
+		this->_wakeUpdate();
+	}
+
+	void AudioManager::_systemPlayGroup(harray<Player*> players)
+	{
+		foreach (Player*, it, players)
+		{
+			(*it)->_systemPlay();
+		}
+	}
+
 	void AudioManager::stop(chstr soundName, float fadeTime)
 	{
 		hmutex::ScopeLock lock(&this->mutex);
@@ -787,9 +1336,30 @@ namespace xal
 	void AudioManager::addAudioExtension(chstr extension)
 	{
 		this->extensions += extension;
+		this->clearAudioFileCache();
+	}
+
+	void AudioManager::clearAudioFileCache()
+	{
+		hmutex::ScopeLock lock(&this->audioFilesMutex);
+		this->audioFiles.clear();
 	}
 
 	hstr AudioManager::findAudioFile(chstr filename)
+	{
+		hmutex::ScopeLock lock(&this->audioFilesMutex);
+		if (this->audioFiles.hasKey(filename))
+		{
+			return this->audioFiles[filename];
+		}
+		lock.release();
+		hstr result = this->_findAudioFile(filename);
+		lock.acquire(&this->audioFilesMutex);
+		this->audioFiles[filename] = result;
+		return result;
+	}
+
+	hstr AudioManager::_findAudioFile(chstr filename)
 	{
 		if (hresource::exists(filename))
 		{
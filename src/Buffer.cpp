@@ -18,21 +18,81 @@
 #include "BufferAsync.h"
 #include "Category.h"
 #include "Sound.h"
+#include "SoundBank.h"
 #include "Source.h"
+#include "StreamFeeder.h"
 #include "xal.h"
 
+// enough for the first Ogg page header with a full segment table and the start of its first packet
+#define FORMAT_HEADER_SIZE 320
+// size of an Ogg page header including the segment count
+#define OGG_HEADER_SIZE 27
+
 namespace xal
 {
-	Buffer::Buffer(Sound* sound)
+	/// @return The format identified by the magic bytes at the start of the file data.
+	static Format _findFormat(const unsigned char* header, int size)
+	{
+		if (size >= 12 && memcmp(header, "RIFF", 4) == 0 && memcmp(&header[8], "WAVE", 4) == 0)
+		{
+#ifdef _FORMAT_WAV
+			return WAV;
+#endif
+		}
+		else if (size >= 4 && memcmp(header, "fLaC", 4) == 0)
+		{
+#ifdef _FORMAT_FLAC
+			return FLAC;
+#endif
+		}
+		else if (size >= 8 && memcmp(&header[4], "ftyp", 4) == 0)
+		{
+#ifdef _FORMAT_M4A
+			return M4A;
+#endif
+		}
+		else if (size >= OGG_HEADER_SIZE && memcmp(header, "OggS", 4) == 0)
+		{
+			// the codec is identified by the first packet which is always the only one in the first page
+			int offset = OGG_HEADER_SIZE + header[OGG_HEADER_SIZE - 1];
+			const unsigned char* packet = &header[offset];
+			if (offset + 8 > size)
+			{
+				return UNKNOWN;
+			}
+#ifdef _FORMAT_OGG
+			if (memcmp(packet, "\x01vorbis", 7) == 0)
+			{
+				return OGG;
+			}
+#endif
+#ifdef _FORMAT_OPUS
+			if (memcmp(packet, "OpusHead", 8) == 0)
+			{
+				return OPUS;
+			}
+#endif
+#ifdef _FORMAT_SPX
+			if (memcmp(packet, "Speex   ", 8) == 0)
+			{
+				return SPX;
+			}
+#endif
+		}
+		return UNKNOWN;
+	}
+
+	Buffer::Buffer(Sound* sound, Buffer* compressedBuffer)
 	{
 		this->filename = sound->getFilename();
-		this->fileSize = (int)hresource::hinfo(this->filename).size;
+		this->fileSize = 0;
+		this->format = UNKNOWN;
+		this->formatDetected = false;
 		Category* category = sound->getCategory();
 		this->mode = category->getBufferMode();
 		this->loaded = false;
 		this->asyncLoadQueued = false;
 		this->asyncLoadDiscarded = false;
-		this->source = xal::manager->_createSource(this->filename, category->getSourceMode(), this->mode, this->getFormat());
 		this->loadedMetaData = false;
 		this->size = 0;
 		this->channels = 2;
@@ -40,7 +100,83 @@ namespace xal
 		this->bitsPerSample = 16;
 		this->duration = 0.0f;
 		this->idleTime = 0.0f;
-		if (xal::manager->isEnabled() && this->getFormat() != UNKNOWN)
+		this->directData = NULL;
+		this->directDataSize = 0;
+		this->preloadPosition = 0;
+		this->streamPosition = 0;
+		this->loopStart = 0;
+		this->loopEnd = 0;
+		this->loopSource = NULL;
+		this->loopPrepared = false;
+		this->loopRequested = false;
+		this->streamBufferSize = category->getStreamBufferSize();
+		this->playCount = 0;
+		this->aheadData = NULL;
+		this->aheadCapacity = 0;
+		this->aheadChunkSize = 0;
+		this->aheadStart = 0;
+		this->aheadSize = 0;
+		this->aheadEnded = false;
+		this->aheadActive = false;
+		this->aheadLooping = false;
+		this->aheadOutput = NULL;
+		this->aheadOutputSize = 0;
+		SourceMode sourceMode = category->getSourceMode();
+		unsigned char* data = NULL;
+		int64_t dataSize = 0;
+		if (compressedBuffer != NULL)
+		{
+			// a Player's own ring that streams from the encoded data kept in RAM by the Sound's Buffer
+			this->mode = STREAMED;
+			this->format = compressedBuffer->format;
+			this->formatDetected = compressedBuffer->formatDetected;
+			this->fileSize = compressedBuffer->fileSize;
+			sourceMode = DISK;
+			compressedBuffer->_getCompressedData(&data, &dataSize);
+		}
+		else
+		{
+			// files in sound banks are read directly from the sound bank's memory
+			harray<SoundBank*> soundBanks = category->getSoundBanks();
+			foreach (SoundBank*, it, soundBanks)
+			{
+				if ((*it)->getFileData(this->filename, &data, &dataSize))
+				{
+					this->fileSize = (int)dataSize;
+					break;
+				}
+			}
+			if (this->fileSize == 0 && sound->getBuffer() != NULL)
+			{
+				// a streamed Player's own Buffer uses what the Sound's Buffer already knows about the file
+				this->format = sound->getBuffer()->format;
+				this->formatDetected = sound->getBuffer()->formatDetected;
+				this->fileSize = sound->getBuffer()->fileSize;
+			}
+		}
+		if (this->fileSize == 0)
+		{
+			this->_tryLoadManifestMetaData();
+		}
+		if (this->fileSize == 0)
+		{
+			this->fileSize = (int)hresource::hinfo(this->filename).size;
+		}
+		if (this->format == UNKNOWN)
+		{
+			this->format = this->_getFormatFromExtension();
+		}
+		this->source = xal::manager->_createSource(this->filename, sourceMode, this->mode, this->format);
+		if (data != NULL)
+		{
+			this->source->_setMemory(data, dataSize);
+		}
+		// the file is only read right away if the extension doesn't tell anything, otherwise it's checked when opened
+		if (this->format == UNKNOWN)
+		{
+			this->_tryDetectFormat();
+		}
+		if (xal::manager->isEnabled() && this->format != UNKNOWN)
 		{
 			switch (this->mode)
 			{
@@ -58,6 +194,8 @@ namespace xal
 				break;
 			case STREAMED:
 				break;
+			case COMPRESSED:
+				break;
 			default:
 				break;
 			}
@@ -71,6 +209,15 @@ namespace xal
 		this->asyncLoadDiscarded = false;
 		this->loaded = false;
 		delete this->source;
+		if (this->loopSource != NULL)
+		{
+			delete this->loopSource;
+		}
+		if (this->aheadData != NULL)
+		{
+			delete[] this->aheadData;
+			delete[] this->aheadOutput;
+		}
 	}
 	
 	int Buffer::getSize()
@@ -108,7 +255,42 @@ namespace xal
 		return this->duration;
 	}
 
-	Format Buffer::getFormat()
+	void Buffer::_tryDetectFormat()
+	{
+		if (this->formatDetected)
+		{
+			return;
+		}
+		this->formatDetected = true;
+		unsigned char header[FORMAT_HEADER_SIZE] = {0};
+		int size = 0;
+		if (this->source->memory.data != NULL)
+		{
+			size = (int)hmin(this->source->memory.size, (int64_t)FORMAT_HEADER_SIZE);
+			memcpy(header, this->source->memory.data, size);
+		}
+		else if (hresource::exists(this->filename))
+		{
+			hresource file;
+			file.open(this->filename);
+			size = file.readRaw(header, FORMAT_HEADER_SIZE);
+		}
+		Format format = _findFormat(header, size);
+		if (format == UNKNOWN || format == this->format)
+		{
+			return;
+		}
+		hlog::debug(xal::logTag, "Format differs from the file extension or manifest: " + this->filename);
+		this->format = format;
+		// meta-data from a manifest entry belongs to a different file
+		this->loadedMetaData = false;
+		Source* source = xal::manager->_createSource(this->filename, this->source->getSourceMode(), this->mode, this->format);
+		source->_setMemory(this->source->memory.data, this->source->memory.size);
+		delete this->source;
+		this->source = source;
+	}
+
+	Format Buffer::_getFormatFromExtension()
 	{
 #ifdef _FORMAT_FLAC
 		if (this->filename.endsWith(".flac"))
@@ -128,6 +310,12 @@ namespace xal
 			return OGG;
 		}
 #endif
+#ifdef _FORMAT_OPUS
+		if (this->filename.endsWith(".opus"))
+		{
+			return OPUS;
+		}
+#endif
 #ifdef _FORMAT_SPX
 		if (this->filename.endsWith(".spx"))
 		{
@@ -143,6 +331,24 @@ namespace xal
 		return UNKNOWN;
 	}
 
+	unsigned char* Buffer::getData()
+	{
+		if (this->aheadActive)
+		{
+			return this->aheadOutput;
+		}
+		return (this->directData != NULL ? this->directData : (unsigned char*)this->stream);
+	}
+
+	int Buffer::getDataSize()
+	{
+		if (this->aheadActive)
+		{
+			return this->aheadOutputSize;
+		}
+		return (this->directData != NULL ? this->directDataSize : (int)this->stream.size());
+	}
+
 	bool Buffer::isLoaded()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -165,6 +371,17 @@ namespace xal
 		return (this->mode == MANAGED);
 	}
 
+	bool Buffer::isCompressed()
+	{
+		return (this->mode == COMPRESSED);
+	}
+
+	bool Buffer::isDecodingAhead()
+	{
+		hmutex::ScopeLock lock(&this->aheadMutex);
+		return (this->aheadActive && (!this->aheadEnded || this->aheadSize > 0));
+	}
+
 	void Buffer::prepare()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -184,14 +401,16 @@ namespace xal
 			}
 			return;
 		}
+		if (!this->source->isOpen())
+		{
+			this->_tryDetectFormat();
+		}
 		if (!this->isStreamed())
 		{
 			this->loaded = true;
 			this->source->open();
-			this->stream.clear(this->source->getSize());
-			this->source->load(this->stream);
+			this->_loadFromSource();
 			this->source->close();
-			xal::manager->_convertStream(this->source, this->stream);
 			return;
 		}
 		lock.release();
@@ -200,6 +419,15 @@ namespace xal
 		{
 			this->source->open();
 			this->_tryLoadMetaData();
+			this->streamPosition = 0;
+			this->loopStart = this->source->getLoopStart();
+			this->loopEnd = this->source->getLoopEnd();
+			if (this->loopEnd > 0 && this->loopEnd <= this->loopStart)
+			{
+				hlog::warn(xal::logTag, "Invalid loop points, looping the whole data: " + this->filename);
+				this->loopStart = 0;
+				this->loopEnd = 0;
+			}
 		}
 	}
 
@@ -224,6 +452,23 @@ namespace xal
 		return this->asyncLoadQueued;
 	}
 
+	void Buffer::preload(int size)
+	{
+		this->keepLoaded();
+		if (!xal::manager->isEnabled() || !this->isStreamed())
+		{
+			return;
+		}
+		this->prepare();
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		if (this->source->isOpen() && this->preloadStream.size() == 0)
+		{
+			this->preloadStream.clear(size);
+			this->preloadPosition = 0;
+			this->streamPosition += this->source->loadChunk(this->preloadStream, size) / (this->channels * this->bitsPerSample / 8);
+		}
+	}
+
 	int Buffer::load(bool looping, int size)
 	{
 		this->keepLoaded();
@@ -231,11 +476,39 @@ namespace xal
 		{
 			return 0;
 		}
+		// a fed stream only copies what the stream decoder thread decoded ahead
+		if (this->aheadActive)
+		{
+			return this->_loadAhead(size);
+		}
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->_load(looping, size);
+		return this->getDataSize();
+	}
+
+	int Buffer::_load(bool looping, int size)
+	{
+		int result = 0;
 		if (this->isStreamed() && this->source->isOpen())
 		{
-			this->stream.clear(STREAM_BUFFER);
-			int read = this->source->loadChunk(this->stream, size);
+			int frameSize = this->channels * this->bitsPerSample / 8;
+			// a whole chunk of PCM data in memory that doesn't need conversion can be used without copying
+			if (this->preloadStream.size() == 0 && (!looping || this->loopEnd <= 0 || (this->loopEnd - this->streamPosition) * frameSize >= size) &&
+				!xal::manager->_isConversionRequired(this->source) && this->source->_loadChunkDirect(&this->directData, size))
+			{
+				this->directDataSize = size;
+				this->streamPosition += size / frameSize;
+				return size;
+			}
+			this->directData = NULL;
+			this->stream.clear(size);
+			int read = this->_loadPreloaded(size);
+			if (read < size)
+			{
+				read += this->_loadChunk(size - read, looping);
+			}
+			result = read;
+			this->stream.rewind();
 			size -= read;
 			if (size > 0)
 			{
@@ -253,21 +526,126 @@ namespace xal
 				{
 					while (size > 0)
 					{
-						this->source->rewind();
-						read = this->source->loadChunk(this->stream, size);
+						this->_restartLoop();
+						read = this->_loadPreloaded(size);
+						if (read < size)
+						{
+							read += this->_loadChunk(size - read, looping);
+						}
 						if (read == 0) // to prevent an infinite loop
 						{
 							break;
 						}
+						result += read;
 						size -= read;
-						this->stream.seek(read);
 					}
 				}
 				this->stream.rewind();
 			}
 			xal::manager->_convertStream(this->source, this->stream);
 		}
-		return (int)this->stream.size();
+		return result;
+	}
+
+	int Buffer::_loadAhead(int size)
+	{
+		hmutex::ScopeLock lock(&this->aheadMutex);
+		this->aheadOutputSize = hmin(size, this->aheadSize);
+		int first = hmin(this->aheadOutputSize, this->aheadCapacity - this->aheadStart);
+		memcpy(this->aheadOutput, &this->aheadData[this->aheadStart], first);
+		memcpy(&this->aheadOutput[first], this->aheadData, this->aheadOutputSize - first);
+		this->aheadStart = (this->aheadStart + this->aheadOutputSize) % this->aheadCapacity;
+		this->aheadSize -= this->aheadOutputSize;
+		lock.release();
+		StreamFeeder::_wakeDecoder();
+		return this->aheadOutputSize;
+	}
+
+	bool Buffer::_startDecodeAhead(int chunkSize, int chunkCount, bool looping)
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		// data left in the ring is handed back to the Source's position when stopping, which only works if it isn't converted
+		if (!this->isStreamed() || !this->source->isOpen() || xal::manager->_isConversionRequired(this->source))
+		{
+			return false;
+		}
+		hmutex::ScopeLock aheadLock(&this->aheadMutex);
+		if (this->aheadActive)
+		{
+			return true;
+		}
+		int capacity = chunkSize * chunkCount;
+		if (this->aheadCapacity != capacity)
+		{
+			if (this->aheadData != NULL)
+			{
+				delete[] this->aheadData;
+				delete[] this->aheadOutput;
+			}
+			this->aheadData = new unsigned char[capacity];
+			this->aheadOutput = new unsigned char[capacity];
+			this->aheadCapacity = capacity;
+		}
+		this->aheadChunkSize = chunkSize;
+		this->aheadStart = 0;
+		this->aheadSize = 0;
+		this->aheadEnded = false;
+		this->aheadLooping = looping;
+		this->aheadOutputSize = 0;
+		this->aheadActive = true;
+		return true;
+	}
+
+	void Buffer::_stopDecodeAhead()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		hmutex::ScopeLock aheadLock(&this->aheadMutex);
+		if (!this->aheadActive)
+		{
+			return;
+		}
+		this->aheadActive = false;
+		if (this->aheadSize == 0)
+		{
+			return;
+		}
+		// the ring's data was decoded before the rest of the preloaded data
+		int remaining = hmax((int)this->preloadStream.size() - this->preloadPosition, 0);
+		hstream stream(this->aheadSize + remaining);
+		int first = hmin(this->aheadSize, this->aheadCapacity - this->aheadStart);
+		stream.writeRaw(&this->aheadData[this->aheadStart], first);
+		stream.writeRaw(this->aheadData, this->aheadSize - first);
+		if (remaining > 0)
+		{
+			stream.writeRaw(((unsigned char*)this->preloadStream) + this->preloadPosition, remaining);
+		}
+		this->preloadStream.clear(1);
+		this->preloadStream.writeRaw((unsigned char*)stream, (int)stream.size());
+		this->preloadPosition = 0;
+		this->aheadSize = 0;
+	}
+
+	bool Buffer::_decodeAhead()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		hmutex::ScopeLock aheadLock(&this->aheadMutex);
+		if (!this->aheadActive || this->aheadEnded || this->aheadCapacity - this->aheadSize < this->aheadChunkSize)
+		{
+			return false;
+		}
+		// the stream feeder thread only takes data out of the ring so the room can only grow while decoding
+		aheadLock.release();
+		int read = this->_load(this->aheadLooping, this->aheadChunkSize);
+		unsigned char* data = (this->directData != NULL ? this->directData : (unsigned char*)this->stream);
+		int size = hmin((this->directData != NULL ? this->directDataSize : (int)this->stream.size()), this->aheadChunkSize);
+		aheadLock.acquire(&this->aheadMutex);
+		int end = (this->aheadStart + this->aheadSize) % this->aheadCapacity;
+		int first = hmin(size, this->aheadCapacity - end);
+		memcpy(&this->aheadData[end], data, first);
+		memcpy(this->aheadData, &data[first], size - first);
+		this->aheadSize += size;
+		this->aheadEnded = (!this->aheadLooping && read < this->aheadChunkSize);
+		return (size > 0);
 	}
 
 	void Buffer::bind(Player* player, bool playerPaused)
@@ -285,12 +663,19 @@ namespace xal
 		if (this->boundPlayers.size() == 0 && this->mode == xal::ON_DEMAND || this->mode == xal::STREAMED)
 		{
 			this->stream.clear(1);
+			this->preloadStream.clear(1);
+			this->preloadPosition = 0;
+			this->directData = NULL;
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = true;
 			this->loaded = false;
 		}
 		if (this->boundPlayers.size() == 0 && this->mode == xal::STREAMED)
 		{
+			this->_destroyLoopSource();
+			this->loopStream.clear(1);
+			this->loopPrepared = false;
+			this->loopRequested = false;
 			this->source->close();
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = true;
@@ -298,6 +683,12 @@ namespace xal
 		}
 	}
 
+	void Buffer::loadMetaData()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->_tryLoadMetaData();
+	}
+
 	void Buffer::keepLoaded()
 	{
 		this->idleTime = 0.0f;
@@ -306,6 +697,154 @@ namespace xal
 	void Buffer::rewind()
 	{
 		this->source->rewind();
+		this->preloadStream.clear(1);
+		this->preloadPosition = 0;
+		this->streamPosition = 0;
+	}
+
+	bool Buffer::seek(int64_t samplePosition)
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->preloadStream.clear(1);
+		this->preloadPosition = 0;
+		if (!this->isStreamed() || !this->source->isOpen() || !this->source->seek(samplePosition))
+		{
+			return false;
+		}
+		this->streamPosition = samplePosition;
+		return true;
+	}
+
+	int Buffer::_loadChunk(int size, bool looping)
+	{
+		int frameSize = this->channels * this->bitsPerSample / 8;
+		// without loop points the restart simply rewinds the Source
+		if (looping && (this->loopStart > 0 || this->loopEnd > 0))
+		{
+			if (this->loopEnd > 0)
+			{
+				size = (int)hclamp((this->loopEnd - this->streamPosition) * frameSize, (int64_t)0, (int64_t)size);
+			}
+			if (!this->loopPrepared && !this->loopRequested)
+			{
+				// the loop Source is prepared by the update so the refill at the loop end doesn't have to seek
+				this->loopRequested = true;
+				xal::manager->_wakeUpdate();
+			}
+		}
+		if (size <= 0)
+		{
+			return 0;
+		}
+		int read = this->source->loadChunk(this->stream, size);
+		this->stream.seek(read);
+		this->streamPosition += read / frameSize;
+		return read;
+	}
+
+	void Buffer::_restartLoop()
+	{
+		this->preloadStream.clear(1);
+		this->preloadPosition = 0;
+		if (this->loopPrepared)
+		{
+			// the loop Source is already positioned right behind its decoded data so it simply takes over
+			Source* source = this->source;
+			this->source = this->loopSource;
+			this->loopSource = source;
+			this->preloadStream.writeRaw((unsigned char*)this->loopStream, (int)this->loopStream.size());
+			this->streamPosition = this->loopStart + this->loopStream.size() / (this->channels * this->bitsPerSample / 8);
+			this->loopPrepared = false;
+			this->loopRequested = true;
+			xal::manager->_wakeUpdate();
+			return;
+		}
+		if (this->loopStart > 0)
+		{
+			this->source->seek(this->loopStart);
+		}
+		else
+		{
+			this->source->rewind();
+		}
+		this->streamPosition = this->loopStart;
+	}
+
+	void Buffer::_prepareLoop()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		if (!this->loopRequested)
+		{
+			return;
+		}
+		this->loopRequested = false;
+		if (!this->isStreamed() || !this->source->isOpen() || this->loopPrepared)
+		{
+			return;
+		}
+		if (this->loopSource == NULL)
+		{
+			this->loopSource = xal::manager->_createSource(this->filename, this->source->getSourceMode(), this->mode, this->format);
+			if (this->source->memory.data != NULL)
+			{
+				this->loopSource->_setMemory(this->source->memory.data, this->source->memory.size);
+			}
+			else if (this->source->getSourceMode() == RAM && this->source->stream != NULL)
+			{
+				// reads from the file data already in RAM instead of copying the whole file again
+				hstream* stream = (hstream*)this->source->stream;
+				this->loopSource->_setMemory((unsigned char*)(*stream), stream->size());
+			}
+		}
+		int size = this->streamBufferSize;
+		if (this->loopEnd > 0)
+		{
+			size = (int)hmin((this->loopEnd - this->loopStart) * (this->channels * this->bitsPerSample / 8), (int64_t)size);
+		}
+		// the loop Source isn't used by the refill until it's prepared so the stream doesn't have to wait for the decoding
+		lock.release();
+		this->loopStream.clear(size);
+		bool prepared = ((this->loopSource->isOpen() || this->loopSource->open()) && this->loopSource->seek(this->loopStart));
+		if (prepared)
+		{
+			this->loopSource->loadChunk(this->loopStream, size);
+		}
+		lock.acquire(&this->asyncLoadMutex);
+		this->loopPrepared = (prepared && this->loopStream.size() > 0);
+	}
+
+	void Buffer::_destroyLoopSource()
+	{
+		if (this->loopSource == NULL)
+		{
+			return;
+		}
+		// after a loop restart the Source might reference the RAM data owned by the loop Source
+		if (this->source->stream == NULL && this->loopSource->stream != NULL)
+		{
+			Source* source = this->source;
+			this->source = this->loopSource;
+			this->loopSource = source;
+		}
+		delete this->loopSource;
+		this->loopSource = NULL;
+	}
+
+	int Buffer::_loadPreloaded(int size)
+	{
+		int result = hmin(size, (int)this->preloadStream.size() - this->preloadPosition);
+		if (result <= 0)
+		{
+			return 0;
+		}
+		this->stream.writeRaw(((unsigned char*)this->preloadStream) + this->preloadPosition, result);
+		this->preloadPosition += result;
+		if (this->preloadPosition >= this->preloadStream.size())
+		{
+			this->preloadStream.clear(1);
+			this->preloadPosition = 0;
+		}
+		return result;
 	}
 
 	int Buffer::calcOutputSize(int size)
@@ -322,10 +861,20 @@ namespace xal
 
 	void Buffer::readPcmData(hstream& output)
 	{
-		// no mutex locking, because a separate source is used
-		if (this->getFormat() != UNKNOWN)
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		if (!this->source->isOpen())
+		{
+			this->_tryDetectFormat();
+		}
+		Format format = this->format;
+		unsigned char* data = this->source->memory.data;
+		int64_t dataSize = this->source->memory.size;
+		lock.release();
+		// no further mutex locking, because a separate source is used
+		if (format != UNKNOWN)
 		{
-			Source* source = xal::manager->_createSource(this->filename, xal::DISK, xal::FULL, this->getFormat());
+			Source* source = xal::manager->_createSource(this->filename, xal::DISK, xal::FULL, format);
+			source->_setMemory(data, dataSize);
 			source->open();
 			if (source->getSize() > 0)
 			{
@@ -339,6 +888,10 @@ namespace xal
 
 	void Buffer::_update(float timeDelta)
 	{
+		if (this->isStreamed())
+		{
+			this->_prepareLoop();
+		}
 		this->idleTime += timeDelta;
 		if (this->idleTime >= xal::manager->getIdlePlayerUnloadTime())
 		{
@@ -346,14 +899,33 @@ namespace xal
 		}
 	}
 
+	float Buffer::_calcUpdateDelay()
+	{
+		if (this->isStreamed())
+		{
+			hmutex::ScopeLock lock(&this->asyncLoadMutex);
+			return (this->loopRequested ? 0.0f : -1.0f);
+		}
+		if (!this->isMemoryManaged() && !this->isCompressed())
+		{
+			return -1.0f;
+		}
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		if (!this->loaded || this->boundPlayers.size() > 0)
+		{
+			return -1.0f;
+		}
+		return hmax(xal::manager->getIdlePlayerUnloadTime() - this->idleTime, 0.0f);
+	}
+
 	void Buffer::_tryLoadMetaData()
 	{
 		if (!this->loadedMetaData)
 		{
-			bool open = this->source->isOpen();
-			if (!open)
+			if (!this->source->isOpen())
 			{
-				this->source->open();
+				this->_tryDetectFormat();
+				this->source->probe();
 			}
 			this->size = this->source->getSize();
 			this->channels = this->source->getChannels();
@@ -361,20 +933,45 @@ namespace xal
 			this->bitsPerSample = this->source->getBitsPerSample();
 			this->duration = this->source->getDuration();
 			this->loadedMetaData = true;
-			if (!open)
-			{
-				this->source->close();
-			}
 		}
 	}
 
+	void Buffer::_tryLoadManifestMetaData()
+	{
+		if (!xal::manager->manifest.hasKey(this->filename))
+		{
+			return;
+		}
+		AudioManager::ManifestEntry& entry = xal::manager->manifest[this->filename];
+		// the format is checked against the file's magic bytes once it's opened
+		if (entry.format < 0 || entry.format >= UNKNOWN || entry.modificationTime != (int64_t)hresource::hinfo(this->filename).modificationTime)
+		{
+			return;
+		}
+		this->format = entry.format;
+		this->fileSize = entry.fileSize;
+		this->size = entry.size;
+		this->channels = entry.channels;
+		this->samplingRate = entry.samplingRate;
+		this->bitsPerSample = entry.bitsPerSample;
+		this->duration = entry.duration;
+		this->loadedMetaData = true;
+	}
+
+	void Buffer::_retainSeekIndex()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->source->_retainSeekIndex();
+	}
+
 	bool Buffer::_tryClearMemory()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (this->isMemoryManaged() && this->boundPlayers.size() == 0 && (this->loaded || this->mode == STREAMED))
+		if ((this->isMemoryManaged() || this->isCompressed()) && this->boundPlayers.size() == 0 && (this->loaded || this->mode == STREAMED))
 		{
 			hlog::debug(xal::logTag, "Clearing memory for: " + this->filename);
 			this->stream.clear(1L);
+			this->directData = NULL;
 			this->source->close();
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = true;
@@ -384,6 +981,37 @@ namespace xal
 		return false;
 	}
 
+	void Buffer::_getCompressedData(unsigned char** data, int64_t* dataSize)
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		// the Source reads from the same memory so decoding into the decoded cache doesn't access the file again
+		if (this->source->memory.data == NULL && hresource::exists(this->filename))
+		{
+			hresource resource;
+			resource.open(this->filename);
+			this->compressedData.clear(resource.size());
+			this->compressedData.writeRaw(resource);
+			this->compressedData.rewind();
+			this->source->_setMemory((unsigned char*)this->compressedData, this->compressedData.size());
+		}
+		*data = this->source->memory.data;
+		*dataSize = this->source->memory.size;
+	}
+
+	void Buffer::_loadFromSource()
+	{
+		// PCM data in memory that doesn't need conversion can be used without copying
+		if (!xal::manager->_isConversionRequired(this->source) && this->source->_loadDirect(&this->directData, &this->directDataSize))
+		{
+			this->stream.clear(1);
+			return;
+		}
+		this->directData = NULL;
+		this->stream.clear(this->source->getSize());
+		this->source->load(this->stream);
+		xal::manager->_convertStream(this->source, this->stream);
+	}
+
 	bool Buffer::_prepareAsyncStream()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -393,6 +1021,7 @@ namespace xal
 			this->asyncLoadDiscarded = false;
 			return false;
 		}
+		this->_tryDetectFormat();
 		this->source->open();
 		if (!this->source->isOpen())
 		{
@@ -414,9 +1043,7 @@ namespace xal
 			return;
 		}
 		this->_tryLoadMetaData();
-		this->stream.clear(this->source->getSize());
-		this->source->load(this->stream);
-		xal::manager->_convertStream(this->source, this->stream);
+		this->_loadFromSource();
 		this->source->close();
 		this->asyncLoadQueued = false;
 		this->asyncLoadDiscarded = false;
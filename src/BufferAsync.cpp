@@ -50,18 +50,7 @@ namespace xal
 
 	bool BufferAsync::queueLoad(Buffer* buffer)
 	{
-		if (cpus == 0)
-		{
-#ifdef _WIN32
-			SYSTEM_INFO w32info;
-			GetNativeSystemInfo(&w32info);
-			cpus = w32info.dwNumberOfProcessors;
-#elif defined(__APPLE__) // not sure why, but for Apple hardware the ONLN one is used (possibly some hardware may have locked available cores)
-			cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
-#else // on Android and other Unix it's better to use CONF since they are more flexible than Apple's hardware and might switch cores on/off dynamically
-			cpus = (int)sysconf(_SC_NPROCESSORS_CONF);
-#endif
-		}
+		BufferAsync::getCpuCount();
 		hmutex::ScopeLock lock(&BufferAsync::queueMutex);
 		if (BufferAsync::buffers.has(buffer))
 		{
@@ -106,6 +95,23 @@ namespace xal
 		return BufferAsync::readerRunning;
 	}
 
+	int BufferAsync::getCpuCount()
+	{
+		if (cpus == 0)
+		{
+#ifdef _WIN32
+			SYSTEM_INFO w32info;
+			GetNativeSystemInfo(&w32info);
+			cpus = w32info.dwNumberOfProcessors;
+#elif defined(__APPLE__) // not sure why, but for Apple hardware the ONLN one is used (possibly some hardware may have locked available cores)
+			cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else // on Android and other Unix it's better to use CONF since they are more flexible than Apple's hardware and might switch cores on/off dynamically
+			cpus = (int)sysconf(_SC_NPROCESSORS_CONF);
+#endif
+		}
+		return cpus;
+	}
+
 	void BufferAsync::_read(hthread* thread)
 	{
 		Buffer* buffer = NULL;
@@ -34,6 +34,8 @@ namespace xal
 		static bool queueLoad(Buffer* buffer);
 		static bool prioritizeLoad(Buffer* buffer);
 		static bool isRunning();
+		/// @return Number of CPU cores available for decoding.
+		static int getCpuCount();
 
 	protected:
 		static harray<Buffer*> buffers;
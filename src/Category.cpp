@@ -6,15 +6,18 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <hltypes/harray.h>
 #include <hltypes/hexception.h>
 #include <hltypes/hstring.h>
 
 #include "AudioManager.h"
 #include "Category.h"
+#include "SoundBank.h"
 
 namespace xal
 {
-	Category::Category(chstr name, BufferMode bufferMode, SourceMode sourceMode) : gain(1.0f)
+	Category::Category(chstr name, BufferMode bufferMode, SourceMode sourceMode) : gain(1.0f), streamBufferCount(STREAM_BUFFER_COUNT),
+		streamBufferSize(STREAM_BUFFER_SIZE), adaptiveStreamBuffering(false), underrunCount(0), maxVoices(0)
 	{
 		this->name = name;
 		this->bufferMode = bufferMode;
@@ -23,6 +26,10 @@ namespace xal
 
 	Category::~Category()
 	{
+		foreach (SoundBank*, it, this->soundBanks)
+		{
+			delete (*it);
+		}
 	}
 
 	void Category::setGain(float value)
@@ -32,6 +39,24 @@ namespace xal
 		xal::manager->_setGlobalGain(xal::manager->globalGain); // updates all Player instances with the new category gain
 	}
 
+	void Category::setStreamBufferCount(int value)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->streamBufferCount = hmax(value, 2);
+	}
+
+	void Category::setStreamBufferSize(int value)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		// power of 2 sizes keep whole sample frames in each buffer
+		int size = 1024;
+		while (size < value)
+		{
+			size <<= 1;
+		}
+		this->streamBufferSize = size;
+	}
+
 	bool Category::isStreamed()
 	{
 		return (this->bufferMode == STREAMED);
@@ -0,0 +1,187 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <hltypes/hfile.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hmap.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hplatform.h>
+#include <hltypes/hresource.h>
+#include <hltypes/hstring.h>
+
+#include "FileMapping.h"
+#include "xal.h"
+
+namespace xal
+{
+	hmap<hstr, FileMapping*> FileMapping::mappings;
+	hmutex FileMapping::mappingsMutex;
+
+	FileMapping::FileMapping(chstr filename) : data(NULL), size(0), mapped(false), references(0)
+	{
+		this->filename = filename;
+	}
+
+	FileMapping::~FileMapping()
+	{
+		this->close();
+	}
+
+	bool FileMapping::open(bool loadFallback)
+	{
+		if (this->data != NULL)
+		{
+			return true;
+		}
+		if (this->_map())
+		{
+			this->mapped = true;
+			return true;
+		}
+		if (!loadFallback)
+		{
+			return false;
+		}
+		if (!hresource::exists(this->filename))
+		{
+			hlog::error(xal::logTag, "Unable to open: " + this->filename);
+			return false;
+		}
+		// files in resource archives can't be mapped so they are loaded with a single read
+		hresource resource;
+		resource.open(this->filename);
+		this->size = resource.size();
+		this->data = new unsigned char[(unsigned int)hmax(this->size, (int64_t)1)];
+		this->size = resource.readRaw(this->data, (int)this->size);
+		return true;
+	}
+
+	void FileMapping::close()
+	{
+		if (this->data == NULL)
+		{
+			return;
+		}
+		if (this->mapped)
+		{
+#ifdef _WIN32
+#ifndef _WINRT
+			UnmapViewOfFile(this->data);
+#endif
+#else
+			munmap(this->data, (size_t)this->size);
+#endif
+		}
+		else
+		{
+			delete[] this->data;
+		}
+		this->data = NULL;
+		this->size = 0;
+		this->mapped = false;
+	}
+
+	FileMapping* FileMapping::acquire(chstr filename)
+	{
+		hmutex::ScopeLock lock(&FileMapping::mappingsMutex);
+		FileMapping* mapping = FileMapping::mappings.tryGet(filename, NULL);
+		if (mapping == NULL)
+		{
+			mapping = new FileMapping(filename);
+			if (!mapping->open(false))
+			{
+				delete mapping;
+				return NULL;
+			}
+			FileMapping::mappings[filename] = mapping;
+		}
+		++mapping->references;
+		return mapping;
+	}
+
+	void FileMapping::release(FileMapping* mapping)
+	{
+		hmutex::ScopeLock lock(&FileMapping::mappingsMutex);
+		--mapping->references;
+		if (mapping->references <= 0)
+		{
+			FileMapping::mappings.removeKey(mapping->filename);
+			delete mapping;
+		}
+	}
+
+	bool FileMapping::_map()
+	{
+		if (!hfile::exists(this->filename))
+		{
+			return false;
+		}
+#ifdef _WIN32
+#ifndef _WINRT
+		HANDLE file = CreateFileW(this->filename.wStr().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+		{
+			return false;
+		}
+		// the view keeps the mapping alive so the handle isn't needed anymore
+		this->data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (this->data == NULL)
+		{
+			return false;
+		}
+		this->size = (int64_t)fileSize.QuadPart;
+		return true;
+#else
+		return false;
+#endif
+#else
+		int file = ::open(this->filename.cStr(), O_RDONLY);
+		if (file < 0)
+		{
+			return false;
+		}
+		struct stat info;
+		if (fstat(file, &info) != 0 || info.st_size == 0)
+		{
+			::close(file);
+			return false;
+		}
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, file, 0);
+		// the mapping stays valid after the file was closed
+		::close(file);
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+		this->data = (unsigned char*)data;
+		this->size = (int64_t)info.st_size;
+		return true;
+#endif
+	}
+
+}
@@ -0,0 +1,84 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a read-only memory mapping of a file.
+
+#ifndef XAL_FILE_MAPPING_H
+#define XAL_FILE_MAPPING_H
+
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hstring.h>
+
+#include "xalExport.h"
+
+namespace xal
+{
+	/// @brief Provides read-only access to the whole content of a file in memory.
+	/// @note If the file cannot be mapped (e.g. because it's inside of a resource archive), it is loaded into memory instead.
+	class FileMapping
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] filename Filename of the file.
+		FileMapping(chstr filename);
+		/// @brief Destructor.
+		~FileMapping();
+
+		HL_DEFINE_GET(hstr, filename, Filename);
+		HL_DEFINE_GET(unsigned char*, data, Data);
+		HL_DEFINE_GET(int64_t, size, Size);
+		HL_DEFINE_IS(mapped, Mapped);
+		/// @return True if the file's data is available.
+		inline bool isOpen() { return (this->data != NULL); }
+
+		/// @brief Maps the file into memory.
+		/// @param[in] loadFallback Whether the file should be loaded into memory if it can't be mapped.
+		/// @return True if the file's data is available.
+		bool open(bool loadFallback = true);
+		/// @brief Unmaps the file.
+		void close();
+
+		/// @brief Gets the shared mapping of a file and maps it if it isn't mapped yet.
+		/// @param[in] filename Filename of the file.
+		/// @return The shared mapping or NULL if the file can't be mapped.
+		/// @note Every acquired mapping has to be released with release().
+		static FileMapping* acquire(chstr filename);
+		/// @brief Releases a shared mapping and unmaps the file if it isn't used anymore.
+		/// @param[in] mapping The shared mapping.
+		static void release(FileMapping* mapping);
+
+	protected:
+		/// @brief Filename of the file.
+		hstr filename;
+		/// @brief The file's data.
+		unsigned char* data;
+		/// @brief Byte-size of the file's data.
+		int64_t size;
+		/// @brief Whether the data is actually mapped or was loaded into memory.
+		bool mapped;
+		/// @brief How many times this mapping was acquired.
+		int references;
+
+		/// @brief Shared mappings by filename.
+		static hmap<hstr, FileMapping*> mappings;
+		/// @brief Mutex for access to the shared mappings.
+		static hmutex mappingsMutex;
+
+		/// @brief Maps the file with the operating system's facilities.
+		/// @return True if the file was mapped successfully.
+		bool _map();
+
+	};
+	
+}
+
+#endif
@@ -14,23 +14,42 @@
 #include "Category.h"
 #include "Player.h"
 #include "Sound.h"
+#include "StreamFeeder.h"
 #include "xal.h"
 
+// weight of a new measurement in the smoothed stream refill timing
+#define REFILL_SMOOTHING 0.1f
+// how long the stream refill timing has to be stable before a queued stream buffer is dropped
+#define REFILL_SHRINK_DELAY 10.0f
+
 namespace xal
 {
 	Player::Player(Sound* sound) : gain(1.0f), pitch(1.0f), paused(false), looping(false), fadeSpeed(0.0f),
-		fadeTime(0.0f), offset(0.0f), bufferIndex(0), processedByteCount(0), idleTime(0.0f), asyncPlayQueued(false)
+		fadeTime(0.0f), offset(0.0f), bufferIndex(0), processedByteCount(0), underrunCount(0), refillInterval(0.0f), refillJitter(0.0f),
+		refillDuration(0.0f), refillTime(0.0f), refillStableTime(0.0f), streamFed(false), streamEnded(false), streamUnderrun(false),
+		idleTime(0.0f), seekPosition(-1), virtualized(false), virtualPosition(0.0f), virtualClockTime(0), scheduledTime(-1), scheduledFadeTime(0.0f), scheduledLooping(false), scheduledPrepared(false), scheduleError(0),
+		asyncPlayQueued(false)
 	{
 		this->sound = sound;
+		this->streamBufferCount = sound->getCategory()->getStreamBufferCount();
+		this->streamBufferSize = sound->getCategory()->getStreamBufferSize();
+		this->queuedBufferCount = this->streamBufferCount;
 		this->buffer = sound->getBuffer();
 		if (this->buffer->isStreamed()) // streamed buffers cannot be shared
 		{
 			this->buffer = xal::manager->_createBuffer(this->sound);
 		}
+		else if (this->buffer->isCompressed() && !this->buffer->isLoaded()) // not in the decoded cache, decodes into its own ring
+		{
+			this->buffer = xal::manager->_createBuffer(this->sound, this->buffer);
+		}
 	}
 
 	Player::~Player()
 	{
+		hmutex::ScopeLock streamLock(&StreamFeeder::mutex);
+		StreamFeeder::_removePlayer(this);
+		streamLock.release();
 		hmutex::ScopeLock lock(&this->asyncPlayMutex);
 		this->asyncPlayQueued = false;
 		if (this->buffer->isStreamed()) // this buffer was created internally
@@ -60,6 +79,8 @@ namespace xal
 	{
 		this->gain = hclamp(value, 0.0f, 1.0f);
 		this->_systemUpdateGain();
+		// audibility decides whether the Player is virtual
+		xal::manager->_wakeUpdate();
 	}
 
 	float Player::getPitch()
@@ -81,6 +102,10 @@ namespace xal
 
 	void Player::_setPitch(float value)
 	{
+		if (this->virtualized)
+		{
+			this->_updateVirtualPosition();
+		}
 		this->pitch = hclamp(value, 0.01f, 100.0f);
 		this->_systemUpdatePitch();
 	}
@@ -93,14 +118,31 @@ namespace xal
 	unsigned int Player::getSamplePosition()
 	{
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		return this->_getSamplePosition();
+	}
+
+	unsigned int Player::_getSamplePosition()
+	{
+		if (this->virtualized)
+		{
+			this->_updateVirtualPosition();
+			return (unsigned int)(this->virtualPosition * this->buffer->getSamplingRate());
+		}
+		// the stream feeder thread advances the buffer index and the processed byte count together
+		hmutex::ScopeLock streamLock;
+		if (this->buffer->isStreamed())
+		{
+			streamLock.acquire(&StreamFeeder::mutex);
+		}
 		unsigned int position = this->_systemGetBufferPosition();
-		if (this->sound->isStreamed() && this->_systemNeedsStreamedBufferPositionCorrection())
+		if (this->buffer->isStreamed() && this->_systemNeedsStreamedBufferPositionCorrection())
 		{
 			// corrects position by using number of processed bytes (circular)
-			position = (position + (STREAM_BUFFER_COUNT - this->bufferIndex) * STREAM_BUFFER_SIZE) % STREAM_BUFFER;
+			position = (position + (this->streamBufferCount - this->bufferIndex) * this->streamBufferSize) % (this->streamBufferCount * this->streamBufferSize);
 			// adds streamed processed byte count
 			position += this->processedByteCount;
 		}
+		streamLock.release();
 		position = hmin(position, (unsigned int)this->sound->getSize());
 		return (unsigned int)(position / (this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f));
 	}
@@ -129,7 +171,7 @@ namespace xal
 	{
 		if (this->buffer->isStreamed())
 		{
-			return (int)this->buffer->getStream().size();
+			return this->buffer->getDataSize();
 		}
 		else
 		{
@@ -150,7 +192,7 @@ namespace xal
 
 	bool Player::_isPlaying()
 	{
-		if (this->_systemIsPlaying())
+		if (this->_systemIsPlaying() || this->virtualized || this->scheduledTime >= 0)
 		{
 			return true;
 		}
@@ -177,6 +219,11 @@ namespace xal
 	{
 		return (this->fadeSpeed < 0.0f);
 	}
+
+	bool Player::isScheduled()
+	{
+		return (this->scheduledTime >= 0);
+	}
 	
 	Category* Player::getCategory()
 	{
@@ -195,16 +242,64 @@ namespace xal
 
 	void Player::_update(float timeDelta)
 	{
-		if (this->_isPlaying())
+		if (this->scheduledTime >= 0)
+		{
+			this->_updateSchedule();
+			if (this->scheduledTime >= 0) // not started yet
+			{
+				return;
+			}
+		}
+		if (this->virtualized)
+		{
+			// the position advances without any decoding
+			this->_updateVirtualPosition();
+			float duration = this->buffer->getDuration();
+			if (duration > 0.0f && this->virtualPosition >= duration)
+			{
+				if (!this->looping)
+				{
+					this->_stop();
+					return;
+				}
+				this->virtualPosition -= (int)(this->virtualPosition / duration) * duration;
+			}
+		}
+		else if (this->_isPlaying())
 		{
 			this->buffer->keepLoaded();
-			if (!this->sound->isStreamed())
+			if (!this->buffer->isStreamed())
 			{
 				this->_systemUpdateNormal();
 			}
+			else if (this->streamFed)
+			{
+				// the stream feeder thread refills the stream and only reports what has to be handled here
+				hmutex::ScopeLock lock(&StreamFeeder::mutex);
+				bool ended = this->streamEnded;
+				bool underrun = (this->streamUnderrun && !ended);
+				this->streamEnded = false;
+				this->streamUnderrun = false;
+				if (underrun)
+				{
+					this->_registerUnderrun();
+				}
+				lock.release();
+				if (ended)
+				{
+					this->_stop();
+				}
+				else if (underrun)
+				{
+					this->_restartStream();
+				}
+			}
 			else
 			{
-				this->processedByteCount += this->_systemUpdateStream();
+				int64_t time = htickCount();
+				int processed = this->_systemUpdateStream();
+				this->processedByteCount += processed;
+				this->_updateStreamBuffering(timeDelta, (htickCount() - time) * 0.001f, (processed > 0));
 			}
 		}
 		else if (this->paused)
@@ -250,6 +345,12 @@ namespace xal
 		this->_playAsync(fadeTime, looping);
 	}
 
+	void Player::playAt(int64_t outputSampleTime, float fadeTime, bool looping)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->_playAt(outputSampleTime, fadeTime, looping);
+	}
+
 	void Player::stop(float fadeTime)
 	{
 		hmutex::ScopeLock lock(&xal::manager->mutex);
@@ -261,7 +362,163 @@ namespace xal
 		hmutex::ScopeLock lock(&xal::manager->mutex);
 		this->_pause(fadeTime);
 	}
+
+	void Player::seek(float timePosition)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->_seek((unsigned int)(hmax(timePosition, 0.0f) * this->buffer->getSamplingRate()));
+	}
+
+	void Player::seekSample(unsigned int samplePosition)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->_seek(samplePosition);
+	}
+
+	void Player::preload()
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->_preload();
+	}
 	
+	float Player::_calcUpdateDelay()
+	{
+		if (this->scheduledTime >= 0)
+		{
+			return this->_calcScheduleDelay();
+		}
+		if (this->isFading() || this->_isAsyncPlayQueued())
+		{
+			return 0.0f;
+		}
+		if (this->virtualized)
+		{
+			float duration = this->buffer->getDuration();
+			if (duration <= 0.0f)
+			{
+				return -1.0f;
+			}
+			// the Player needs to be updated when the virtual position reaches the end
+			this->_updateVirtualPosition();
+			return (hmax(duration - this->virtualPosition, 0.0f) / this->pitch);
+		}
+		if (!this->_isPlaying())
+		{
+			return -1.0f;
+		}
+		if (this->buffer->isStreamed())
+		{
+			if (this->streamFed) // only reports from the stream feeder thread need handling
+			{
+				return (this->streamEnded || this->streamUnderrun ? 0.0f : -1.0f);
+			}
+			return this->_calcFeedDelay();
+		}
+		float bytesPerSecond = this->buffer->getSamplingRate() * this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f;
+		if (bytesPerSecond <= 0.0f)
+		{
+			return 0.0f;
+		}
+		// the Player needs to be updated when the Sound ends or loops
+		return (hmax(this->buffer->getSize() - (int)this->_systemGetBufferPosition(), 0) / bytesPerSecond);
+	}
+
+	float Player::_calcScheduleDelay()
+	{
+		if (this->scheduledTime < 0)
+		{
+			return -1.0f;
+		}
+		int64_t remaining = this->scheduledTime - xal::manager->_getOutputSampleTime();
+		if (!this->scheduledPrepared)
+		{
+			remaining -= (int64_t)(xal::manager->scheduleLookahead * xal::manager->samplingRate);
+		}
+		return hmax((float)remaining / xal::manager->samplingRate, 0.0f);
+	}
+
+	float Player::_calcFeedDelay()
+	{
+		float bytesPerSecond = this->buffer->getSamplingRate() * this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f;
+		if (bytesPerSecond <= 0.0f)
+		{
+			return 0.0f;
+		}
+		// half a stream buffer so processed buffers are refilled well before the queue runs dry
+		return (this->streamBufferSize * 0.5f / bytesPerSecond);
+	}
+
+	void Player::_feedStream(float timeDelta)
+	{
+		int64_t time = htickCount();
+		int processed = this->_systemFeedStream();
+		this->processedByteCount += processed;
+		this->_updateStreamBuffering(timeDelta, (htickCount() - time) * 0.001f, (processed > 0));
+		if (this->streamEnded || this->streamUnderrun)
+		{
+			xal::manager->_wakeUpdate();
+		}
+	}
+
+	void Player::_restartStream()
+	{
+		float speed = this->fadeSpeed;
+		float time = this->fadeTime;
+		this->_pause();
+		this->_play();
+		this->fadeSpeed = speed;
+		this->fadeTime = time;
+	}
+
+	void Player::_registerUnderrun()
+	{
+		++this->underrunCount;
+		Category* category = this->sound->getCategory();
+		++category->underrunCount;
+		if (category->isAdaptiveStreamBuffering() && this->queuedBufferCount < this->streamBufferCount)
+		{
+			++this->queuedBufferCount;
+			hlog::debugf(xal::logTag, "Underrun, queuing %d stream buffers for: %s", this->queuedBufferCount, this->sound->getFilename().cStr());
+		}
+		this->refillStableTime = 0.0f;
+	}
+
+	void Player::_updateStreamBuffering(float timeDelta, float duration, bool refilled)
+	{
+		this->refillTime += timeDelta;
+		this->refillStableTime += timeDelta;
+		if (!refilled)
+		{
+			return;
+		}
+		this->refillJitter += (habs(this->refillTime - this->refillInterval) - this->refillJitter) * REFILL_SMOOTHING;
+		this->refillInterval += (this->refillTime - this->refillInterval) * REFILL_SMOOTHING;
+		this->refillDuration += (duration - this->refillDuration) * REFILL_SMOOTHING;
+		this->refillTime = 0.0f;
+		if (!this->sound->getCategory()->isAdaptiveStreamBuffering())
+		{
+			return;
+		}
+		float bytesPerSecond = this->buffer->getSamplingRate() * this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f;
+		if (bytesPerSecond <= 0.0f)
+		{
+			return;
+		}
+		// the buffer that is playing doesn't count, the rest has to last until the next refill is done even in a bad case
+		float required = (this->refillInterval + this->refillJitter * 2.0f + this->refillDuration) * bytesPerSecond / this->streamBufferSize;
+		int count = hclamp(hceil(required) + 1, 2, this->streamBufferCount);
+		if (count > this->queuedBufferCount)
+		{
+			this->queuedBufferCount = count;
+			this->refillStableTime = 0.0f;
+		}
+		else if (count < this->queuedBufferCount && this->refillStableTime >= REFILL_SHRINK_DELAY)
+		{
+			--this->queuedBufferCount;
+			this->refillStableTime = 0.0f;
+		}
+	}
+
 	void Player::_play(float fadeTime, bool looping)
 	{
 		if (!xal::manager->isEnabled())
@@ -280,24 +537,168 @@ namespace xal
 			}
 			return;
 		}
-		if (!this->_systemPreparePlay())
+		if (this->virtualized)
+		{
+			// keeps playing virtually, only the fading changes
+			if (fadeTime > 0.0f)
+			{
+				this->fadeSpeed = 1.0f / fadeTime;
+			}
+			else
+			{
+				this->fadeTime = 1.0f;
+				this->fadeSpeed = 0.0f;
+			}
+			return;
+		}
+		bool alreadyFading = this->isFading();
+		bool starting = (!alreadyFading && !this->_systemIsPlaying());
+		if (starting && !xal::manager->_acquireVoice(this))
+		{
+			this->_playVirtual(fadeTime, looping);
+			return;
+		}
+		hmutex::ScopeLock streamLock;
+		if (this->buffer->isStreamed())
+		{
+			// the stream feeder thread must not access the stream while it's being set up
+			streamLock.acquire(&StreamFeeder::mutex);
+		}
+		if (!this->_preparePlay(fadeTime, looping))
+		{
+			if (!starting)
+			{
+				return;
+			}
+			streamLock.release();
+			// the audio-system ran out of voices so a less important Player has to give up its voice
+			xal::manager->_registerSystemVoiceLimit();
+			if (!xal::manager->_acquireVoice(this))
+			{
+				this->_playVirtual(fadeTime, looping);
+				return;
+			}
+			if (this->buffer->isStreamed())
+			{
+				streamLock.acquire(&StreamFeeder::mutex);
+			}
+			if (!this->_preparePlay(fadeTime, looping))
+			{
+				streamLock.release();
+				this->_playVirtual(fadeTime, looping);
+				return;
+			}
+		}
+		if (!alreadyFading)
+		{
+			this->_systemPlay();
+		}
+		this->paused = false;
+		if (this->buffer->isStreamed())
+		{
+			StreamFeeder::_addPlayer(this);
+			streamLock.release();
+		}
+		hmutex::ScopeLock lock(&this->asyncPlayMutex);
+		this->asyncPlayQueued = false;
+		lock.release();
+		xal::manager->_wakeUpdate();
+	}
+
+	void Player::_playAt(int64_t outputSampleTime, float fadeTime, bool looping)
+	{
+		if (!xal::manager->isEnabled())
+		{
+			return;
+		}
+		this->scheduledTime = hmax(outputSampleTime, (int64_t)0);
+		this->scheduledFadeTime = fadeTime;
+		this->scheduledLooping = looping;
+		this->scheduledPrepared = false;
+		this->_updateSchedule();
+		xal::manager->_wakeUpdate();
+	}
+
+	void Player::_updateSchedule()
+	{
+		if (this->scheduledTime < 0 || xal::manager->isSuspended())
+		{
+			return;
+		}
+		int64_t time = xal::manager->_getOutputSampleTime();
+		if (!this->scheduledPrepared)
+		{
+			if (this->scheduledTime - time > (int64_t)(xal::manager->scheduleLookahead * xal::manager->samplingRate))
+			{
+				return;
+			}
+			this->scheduledPrepared = true;
+			if (this->scheduledTime > time && this->_systemSetStartTime(this->scheduledTime))
+			{
+				// the audio-system holds back the voice until the start time and measures the error itself
+				this->scheduledTime = -1;
+				this->_play(this->scheduledFadeTime, this->scheduledLooping);
+				return;
+			}
+			hmutex::ScopeLock streamLock;
+			if (this->buffer->isStreamed())
+			{
+				streamLock.acquire(&StreamFeeder::mutex);
+			}
+			// all data is prepared ahead so only the voice needs to be started on time
+			if (!this->_preparePlay(this->scheduledFadeTime, this->scheduledLooping))
+			{
+				this->scheduledTime = -1;
+				return;
+			}
+		}
+		if (time < this->scheduledTime)
 		{
 			return;
 		}
+		this->scheduleError = time - this->scheduledTime;
+		this->scheduledTime = -1;
+		if (!xal::manager->_acquireVoice(this))
+		{
+			// the prepared voice is given up again
+			this->processedByteCount += this->_systemStop();
+			this->buffer->unbind(this, false);
+			this->_playVirtual(this->scheduledFadeTime, this->scheduledLooping);
+			return;
+		}
+		hlog::debugf(xal::logTag, "Scheduled start of '%s' missed by %d samples.", this->getName().cStr(), (int)this->scheduleError);
+		hmutex::ScopeLock streamLock;
+		if (this->buffer->isStreamed())
+		{
+			streamLock.acquire(&StreamFeeder::mutex);
+		}
+		this->_systemPlay();
+		this->paused = false;
+		if (this->buffer->isStreamed())
+		{
+			StreamFeeder::_addPlayer(this);
+			streamLock.release();
+		}
+		xal::manager->_wakeUpdate();
+	}
+
+	bool Player::_preparePlay(float fadeTime, bool looping)
+	{
+		if (!this->_systemPreparePlay())
+		{
+			return false;
+		}
 		if (!this->paused)
 		{
 			this->looping = looping;
 		}
-		bool alreadyFading = this->isFading();
-		if (!alreadyFading && !this->_systemIsPlaying())
+		if (!this->isFading() && !this->_systemIsPlaying())
 		{
-			this->buffer->prepare();
-			this->_systemPrepareBuffer();
-			if (this->paused)
+			if (this->sound->getBuffer()->isCompressed())
 			{
-				this->_systemSetOffset(this->offset);
+				xal::manager->_registerCompressedPlay(this->sound->getBuffer());
 			}
-			this->buffer->bind(this, this->paused);
+			this->_prepareBuffer();
 		}
 		if (fadeTime > 0.0f)
 		{
@@ -310,13 +711,142 @@ namespace xal
 		}
 		this->_systemUpdateGain();
 		this->_systemUpdatePitch();
-		if (!alreadyFading)
+		return true;
+	}
+
+	void Player::_prepareBuffer()
+	{
+		this->buffer->prepare();
+		if (this->buffer != this->sound->getBuffer())
 		{
-			this->_systemPlay();
+			// the Sound's Buffer keeps the seek index so following Players of the Sound don't have to build it again
+			this->sound->getBuffer()->_retainSeekIndex();
+		}
+		if (this->seekPosition < 0)
+		{
+			this->_systemPrepareBuffer();
+			if (this->paused)
+			{
+				this->_systemSetOffset(this->offset);
+			}
+		}
+		else if (!this->buffer->isStreamed())
+		{
+			this->_systemPrepareBuffer();
+			if (!this->_systemSeek(this->seekPosition))
+			{
+				hlog::warn(xal::logTag, "Audio-system cannot seek: " + this->getName());
+			}
+		}
+		else
+		{
+			// data kept queued from before pausing is discarded and the stream is filled from the new position
+			this->buffer->seek(this->seekPosition);
+			this->processedByteCount = (int)(this->seekPosition * this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f);
+			if (!this->_systemSeek(this->seekPosition))
+			{
+				this->_systemPrepareBuffer();
+			}
+		}
+		this->seekPosition = -1;
+		this->buffer->bind(this, this->paused);
+	}
+
+	void Player::_playVirtual(float fadeTime, bool looping)
+	{
+		if (!this->paused)
+		{
+			this->looping = looping;
+			this->virtualPosition = 0.0f;
+		}
+		// the duration is needed to know when the Sound ends
+		this->buffer->loadMetaData();
+		if (this->seekPosition >= 0)
+		{
+			this->virtualPosition = (float)this->seekPosition / this->buffer->getSamplingRate();
+			this->seekPosition = -1;
+		}
+		this->virtualClockTime = xal::manager->_getOutputSampleTime();
+		this->virtualized = true;
+		if (fadeTime > 0.0f)
+		{
+			this->fadeSpeed = 1.0f / fadeTime;
+		}
+		else
+		{
+			this->fadeTime = 1.0f;
+			this->fadeSpeed = 0.0f;
 		}
 		this->paused = false;
 		hmutex::ScopeLock lock(&this->asyncPlayMutex);
 		this->asyncPlayQueued = false;
+		lock.release();
+		xal::manager->_wakeUpdate();
+	}
+
+	void Player::_virtualize()
+	{
+		this->virtualPosition = (float)this->_getSamplePosition() / this->buffer->getSamplingRate();
+		this->virtualClockTime = xal::manager->_getOutputSampleTime();
+		hmutex::ScopeLock streamLock;
+		if (this->buffer->isStreamed())
+		{
+			streamLock.acquire(&StreamFeeder::mutex);
+			StreamFeeder::_removePlayer(this);
+			this->streamEnded = false;
+			this->streamUnderrun = false;
+		}
+		this->_systemStop();
+		streamLock.release();
+		this->buffer->unbind(this, false);
+		this->processedByteCount = 0;
+		this->offset = 0.0f;
+		this->virtualized = true;
+	}
+
+	bool Player::_promote()
+	{
+		hmutex::ScopeLock streamLock;
+		if (this->buffer->isStreamed())
+		{
+			streamLock.acquire(&StreamFeeder::mutex);
+		}
+		if (!this->_systemPreparePlay())
+		{
+			return false;
+		}
+		this->_updateVirtualPosition();
+		this->virtualized = false;
+		// continues where the virtual playback is
+		this->seekPosition = (int)(this->virtualPosition * this->buffer->getSamplingRate());
+		this->_prepareBuffer();
+		this->_systemUpdateGain();
+		this->_systemUpdatePitch();
+		this->_systemPlay();
+		if (this->buffer->isStreamed())
+		{
+			StreamFeeder::_addPlayer(this);
+		}
+		return true;
+	}
+
+	void Player::_updateVirtualPosition()
+	{
+		int64_t time = xal::manager->_getOutputSampleTime();
+		this->virtualPosition += (float)(time - this->virtualClockTime) / xal::manager->samplingRate * this->pitch;
+		this->virtualClockTime = time;
+	}
+
+	bool Player::_isLessImportant(Player* other)
+	{
+		int priority = this->sound->getPriority();
+		int otherPriority = other->sound->getPriority();
+		if (priority != otherPriority)
+		{
+			return (priority < otherPriority);
+		}
+		// among equally important Players the quieter one matters less
+		return (this->gain * this->sound->getCategory()->getGain() < other->gain * other->sound->getCategory()->getGain());
 	}
 
 	void Player::_playAsync(float fadeTime, bool looping)
@@ -341,6 +871,8 @@ namespace xal
 		this->buffer->prepareAsync();
 		hmutex::ScopeLock lock(&this->asyncPlayMutex);
 		this->asyncPlayQueued = true;
+		lock.release();
+		xal::manager->_wakeUpdate();
 	}
 
 	void Player::_stop(float fadeTime)
@@ -353,6 +885,7 @@ namespace xal
 		this->_stopSound(fadeTime);
 		this->offset = 0.0f;
 		this->processedByteCount = 0;
+		this->seekPosition = -1;
 	}
 
 	void Player::_pause(float fadeTime)
@@ -366,6 +899,97 @@ namespace xal
 		this->_stopSound(fadeTime);
 	}
 
+	void Player::_preload()
+	{
+		if (!xal::manager->isEnabled() || this->paused || this->isFading() || this->_isPlaying())
+		{
+			return;
+		}
+		if (this->buffer->isStreamed())
+		{
+			this->buffer->preload(this->streamBufferCount * this->streamBufferSize);
+		}
+		else
+		{
+			this->buffer->prepareAsync();
+		}
+	}
+
+	void Player::_seek(unsigned int samplePosition)
+	{
+		int frameSize = (int)(this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f);
+		unsigned int sampleCount = this->buffer->getSize() / frameSize;
+		if (sampleCount > 0)
+		{
+			samplePosition = hmin(samplePosition, sampleCount);
+		}
+		if (this->virtualized)
+		{
+			this->virtualPosition = (float)samplePosition / this->buffer->getSamplingRate();
+			this->virtualClockTime = xal::manager->_getOutputSampleTime();
+			return;
+		}
+		if (!this->_systemIsPlaying())
+		{
+			// applied once the voice is prepared
+			this->seekPosition = (int)samplePosition;
+			if (this->scheduledTime >= 0 && this->scheduledPrepared)
+			{
+				// the voice was already prepared for the scheduled start
+				hmutex::ScopeLock streamLock;
+				if (this->buffer->isStreamed())
+				{
+					streamLock.acquire(&StreamFeeder::mutex);
+				}
+				this->_prepareBuffer();
+			}
+			return;
+		}
+		if (!this->buffer->isStreamed())
+		{
+			if (!this->_systemSeek(samplePosition))
+			{
+				hlog::warn(xal::logTag, "Audio-system cannot seek: " + this->getName());
+			}
+			return;
+		}
+		// the stream feeder thread must not refill the stream while it's being repositioned
+		hmutex::ScopeLock streamLock(&StreamFeeder::mutex);
+		// the data decoded ahead at the old position is discarded and the refill below has to load synchronously
+		bool streamFed = this->streamFed;
+		StreamFeeder::_removePlayer(this);
+		if (!this->buffer->seek(samplePosition))
+		{
+			hlog::warn(xal::logTag, "Source cannot seek: " + this->getName());
+			if (streamFed)
+			{
+				StreamFeeder::_addPlayer(this);
+			}
+			return;
+		}
+		this->streamEnded = false;
+		this->streamUnderrun = false;
+		if (!this->_systemSeek(samplePosition))
+		{
+			// restarting the voice works with every audio-system, stopping it rewinds the stream though
+			bool paused = this->paused;
+			this->paused = false;
+			this->_systemStop();
+			this->buffer->seek(samplePosition);
+			this->_systemPreparePlay();
+			this->_systemPrepareBuffer();
+			this->paused = paused;
+			this->_systemUpdateGain();
+			this->_systemUpdatePitch();
+			this->_systemPlay();
+		}
+		if (streamFed)
+		{
+			StreamFeeder::_addPlayer(this);
+		}
+		this->processedByteCount = samplePosition * frameSize;
+	}
+
 	float Player::_calcGain()
 	{
 		float result = this->gain * this->sound->getCategory()->getGain() * xal::manager->getGlobalGain();
@@ -381,16 +1005,41 @@ namespace xal
 		hmutex::ScopeLock lock(&this->asyncPlayMutex);
 		this->asyncPlayQueued = false;
 		lock.release();
+		this->scheduledTime = -1;
+		// fading needs updates and stopped managed Players need to be cleaned up
+		xal::manager->_wakeUpdate();
 		if (fadeTime > 0.0f)
 		{
 			this->fadeSpeed = -1.0f / fadeTime;
 			return;
 		}
+		this->fadeTime = 0.0f;
+		this->fadeSpeed = 0.0f;
+		if (this->virtualized) // there is no voice to stop
+		{
+			this->_updateVirtualPosition();
+			this->virtualized = false;
+			if (this->paused)
+			{
+				this->seekPosition = (int)(this->virtualPosition * this->buffer->getSamplingRate());
+			}
+			return;
+		}
+		if (this->paused)
+		{
+			this->virtualPosition = (float)this->_getSamplePosition() / this->buffer->getSamplingRate();
+		}
+		hmutex::ScopeLock streamLock;
+		if (this->buffer->isStreamed())
+		{
+			streamLock.acquire(&StreamFeeder::mutex);
+			StreamFeeder::_removePlayer(this);
+			this->streamEnded = false;
+			this->streamUnderrun = false;
+		}
 		this->offset = this->_systemGetOffset();
 		this->processedByteCount += this->_systemStop();
 		this->buffer->unbind(this, this->paused);
-		this->fadeTime = 0.0f;
-		this->fadeSpeed = 0.0f;
 	}
 
 }
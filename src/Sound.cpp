@@ -20,7 +20,7 @@
 
 namespace xal
 {
-	Sound::Sound(chstr filename, Category* category, chstr prefix)
+	Sound::Sound(chstr filename, Category* category, chstr prefix) : buffer(NULL), maxInstances(0), priority(0)
 	{
 		this->filename = filename;
 		this->category = category;
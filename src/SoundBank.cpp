@@ -0,0 +1,194 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/harray.h>
+#include <hltypes/hfile.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
+#include <hltypes/hresource.h>
+#include <hltypes/hstring.h>
+
+#include "SoundBank.h"
+#include "xal.h"
+
+#define SOUND_BANK_HEADER "XALBANK1"
+#define SOUND_BANK_HEADER_SIZE 8
+#define SOUND_BANK_ALIGNMENT 16
+
+namespace xal
+{
+	static uint64_t _readLittleEndian(unsigned char* data, int size)
+	{
+		uint64_t result = 0;
+		for (int i = size - 1; i >= 0; --i)
+		{
+			result = (result << 8) | data[i];
+		}
+		return result;
+	}
+
+	static void _writeLittleEndian(hfile& file, uint64_t value, int size)
+	{
+		unsigned char data[8];
+		for_iter (i, 0, size)
+		{
+			data[i] = (unsigned char)(value & 0xFF);
+			value >>= 8;
+		}
+		file.writeRaw(data, size);
+	}
+
+	SoundBank::SoundBank(chstr filename) : mapping(filename)
+	{
+		this->filename = filename;
+	}
+
+	SoundBank::~SoundBank()
+	{
+		this->mapping.close();
+	}
+
+	harray<hstr> SoundBank::getFilenames()
+	{
+		return this->entries.keys();
+	}
+
+	bool SoundBank::open()
+	{
+		if (this->mapping.isOpen())
+		{
+			return true;
+		}
+		if (!this->mapping.open())
+		{
+			return false;
+		}
+		unsigned char* data = this->mapping.getData();
+		int64_t size = this->mapping.getSize();
+		if (size < SOUND_BANK_HEADER_SIZE + 4 || memcmp(data, SOUND_BANK_HEADER, SOUND_BANK_HEADER_SIZE) != 0)
+		{
+			hlog::error(xal::logTag, "Not a sound bank: " + this->filename);
+			this->mapping.close();
+			return false;
+		}
+		int64_t position = SOUND_BANK_HEADER_SIZE;
+		int count = (int)_readLittleEndian(&data[position], 4);
+		position += 4;
+		int nameSize = 0;
+		Entry entry;
+		for_iter (i, 0, count)
+		{
+			if (position + 2 > size)
+			{
+				break;
+			}
+			nameSize = (int)_readLittleEndian(&data[position], 2);
+			position += 2;
+			if (position + nameSize + 16 > size)
+			{
+				break;
+			}
+			hstr name((char*)&data[position], nameSize);
+			position += nameSize;
+			entry.offset = (int64_t)_readLittleEndian(&data[position], 8);
+			entry.size = (int64_t)_readLittleEndian(&data[position + 8], 8);
+			position += 16;
+			if (entry.offset < position || entry.offset + entry.size > size)
+			{
+				break;
+			}
+			this->entries[this->filename + "/" + name] = entry;
+		}
+		if (this->entries.size() != count)
+		{
+			hlog::error(xal::logTag, "Corrupt sound bank index: " + this->filename);
+			this->entries.clear();
+			this->mapping.close();
+			return false;
+		}
+		hlog::debugf(xal::logTag, "Opened sound bank with %d files (%s): %s", count, this->mapping.isMapped() ? "mapped" : "loaded", this->filename.cStr());
+		return true;
+	}
+
+	bool SoundBank::hasFile(chstr filename)
+	{
+		return this->entries.hasKey(filename);
+	}
+
+	bool SoundBank::getFileData(chstr filename, unsigned char** data, int64_t* size)
+	{
+		if (!this->mapping.isOpen() || !this->entries.hasKey(filename))
+		{
+			return false;
+		}
+		Entry& entry = this->entries[filename];
+		*data = &this->mapping.getData()[entry.offset];
+		*size = entry.size;
+		return true;
+	}
+
+	bool SoundBank::pack(chstr filename, chstr path, harray<hstr> files)
+	{
+		harray<hstr> names;
+		harray<int64_t> sizes;
+		int64_t size = 0;
+		int64_t offset = SOUND_BANK_HEADER_SIZE + 4;
+		foreach (hstr, it, files)
+		{
+			if (!hresource::exists(*it))
+			{
+				hlog::error(xal::logTag, "Unable to open: " + (*it));
+				return false;
+			}
+			names += ((*it).startsWith(path + "/") ? (*it)(path.size() + 1, (*it).size() - path.size() - 1) : (*it));
+			offset += 2 + names.last().size() + 16;
+			sizes += hresource::hinfo(*it).size;
+		}
+		hfile file;
+		file.open(filename, hfile::WRITE);
+		if (!file.isOpen())
+		{
+			hlog::error(xal::logTag, "Unable to write sound bank: " + filename);
+			return false;
+		}
+		file.writeRaw(SOUND_BANK_HEADER, SOUND_BANK_HEADER_SIZE);
+		_writeLittleEndian(file, names.size(), 4);
+		// aligned data allows direct access to PCM samples
+		harray<int64_t> offsets;
+		for_iter (i, 0, names.size())
+		{
+			offset = (offset + SOUND_BANK_ALIGNMENT - 1) / SOUND_BANK_ALIGNMENT * SOUND_BANK_ALIGNMENT;
+			offsets += offset;
+			_writeLittleEndian(file, names[i].size(), 2);
+			file.writeRaw(names[i].cStr(), names[i].size());
+			_writeLittleEndian(file, offset, 8);
+			_writeLittleEndian(file, sizes[i], 8);
+			offset += sizes[i];
+		}
+		unsigned char padding[SOUND_BANK_ALIGNMENT] = {0};
+		hresource resource;
+		for_iter (i, 0, files.size())
+		{
+			size = file.position();
+			if (size < offsets[i])
+			{
+				file.writeRaw(padding, (int)(offsets[i] - size));
+			}
+			resource.open(files[i]);
+			file.writeRaw(resource);
+			resource.close();
+		}
+		file.close();
+		hlog::writef(xal::logTag, "Packed %d files into sound bank: %s", files.size(), filename.cStr());
+		return true;
+	}
+
+}
@@ -0,0 +1,85 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a container of many audio files in one file.
+
+#ifndef XAL_SOUND_BANK_H
+#define XAL_SOUND_BANK_H
+
+#include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
+#include <hltypes/hstring.h>
+
+#include "FileMapping.h"
+#include "xalExport.h"
+
+namespace xal
+{
+	/// @brief Provides access to audio files packed into a single file that is mapped into memory once.
+	/// @note The file starts with the header "XALBANK1", followed by a 32 bit entry count and the index. Each index entry consists of a 16 bit name length, the name,
+	/// a 64 bit offset and a 64 bit size. The files' data is stored after the index, aligned to 16 bytes. All values are little endian.
+	class SoundBank
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] filename Filename of the sound bank.
+		SoundBank(chstr filename);
+		/// @brief Destructor.
+		~SoundBank();
+
+		HL_DEFINE_GET(hstr, filename, Filename);
+		/// @return Logical filenames of all packed files.
+		/// @note Logical filenames consist of the sound bank's filename and the packed file's name, separated by "/".
+		harray<hstr> getFilenames();
+
+		/// @brief Maps the sound bank and reads its index.
+		/// @return True if the sound bank was opened successfully.
+		bool open();
+		/// @brief Checks whether a file is packed in this sound bank.
+		/// @param[in] filename Logical filename of the file.
+		/// @return True if the file is packed in this sound bank.
+		bool hasFile(chstr filename);
+		/// @brief Gets the data of a packed file without copying it.
+		/// @param[in] filename Logical filename of the file.
+		/// @param[out] data The file data.
+		/// @param[out] size Byte-size of the file data.
+		/// @return True if the file is packed in this sound bank.
+		bool getFileData(chstr filename, unsigned char** data, int64_t* size);
+
+		/// @brief Packs files into a sound bank.
+		/// @param[in] filename Filename of the sound bank.
+		/// @param[in] path Path of the files that are packed. Names of the packed files are relative to this path.
+		/// @param[in] files Filenames of the files that are packed.
+		/// @return True if the sound bank was written successfully.
+		static bool pack(chstr filename, chstr path, harray<hstr> files);
+
+	protected:
+		/// @brief Location of a packed file.
+		struct Entry
+		{
+			/// @brief Offset of the file data from the beginning of the sound bank.
+			int64_t offset;
+			/// @brief Byte-size of the file data.
+			int64_t size;
+		};
+
+		/// @brief Filename of the sound bank.
+		hstr filename;
+		/// @brief Memory mapping of the whole sound bank.
+		FileMapping mapping;
+		/// @brief Packed file locations by logical filename.
+		hmap<hstr, Entry> entries;
+
+	};
+	
+}
+
+#endif
@@ -6,23 +6,32 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <string.h>
+
+#include <hltypes/harray.h>
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
 #include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 #include <hltypes/hresource.h>
 
 #include "AudioManager.h"
+#include "FileMapping.h"
 #include "Source.h"
 #include "xal.h"
 
 namespace xal
 {
 	Source::Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : streamOpen(false),
-		size(0), channels(2), samplingRate(44100), bitsPerSample(16), duration(0.0f), stream(NULL)
+		size(0), channels(2), samplingRate(44100), bitsPerSample(16), duration(0.0f), loopStart(0), loopEnd(0), stream(NULL), mapping(NULL)
 	{
 		this->filename = filename;
 		this->sourceMode = sourceMode;
 		this->bufferMode = bufferMode;
+		this->memory.data = NULL;
+		this->memory.size = 0;
+		this->memory.position = 0;
 	}
 
 	Source::~Source()
@@ -31,6 +40,10 @@ namespace xal
 		{
 			delete this->stream;
 		}
+		if (this->mapping != NULL)
+		{
+			FileMapping::release(this->mapping);
+		}
 	}
 
 	int Source::getRamSize()
@@ -44,6 +57,26 @@ namespace xal
 
 	bool Source::open()
 	{
+		// the mapping is kept when closing so reopening doesn't need to map the file again
+		if (this->sourceMode == MMAP && this->mapping == NULL)
+		{
+			this->mapping = FileMapping::acquire(this->filename);
+			if (this->mapping != NULL)
+			{
+				this->_setMemory(this->mapping->getData(), this->mapping->getSize());
+			}
+			else
+			{
+				hlog::warn(xal::logTag, "Unable to map, using DISK instead: " + this->filename);
+				this->sourceMode = DISK;
+			}
+		}
+		if (this->memory.data != NULL)
+		{
+			this->memory.position = 0;
+			this->streamOpen = true;
+			return this->streamOpen;
+		}
 		if (!hresource::exists(this->filename))
 		{
 			hlog::error(xal::logTag, "Unable to open: " + this->filename);
@@ -74,6 +107,34 @@ namespace xal
 		return this->streamOpen;
 	}
 
+	bool Source::probe()
+	{
+		if (this->streamOpen)
+		{
+			return true;
+		}
+		// reading only the headers avoids copying the whole file into RAM
+		if (this->memory.data == NULL && this->stream == NULL && (this->sourceMode != DISK || this->bufferMode == ASYNC))
+		{
+			if (!hresource::exists(this->filename))
+			{
+				hlog::error(xal::logTag, "Unable to open: " + this->filename);
+				return false;
+			}
+			this->stream = new hresource(this->filename);
+			bool result = this->_readMetaData();
+			delete this->stream;
+			this->stream = NULL;
+			if (result)
+			{
+				return true;
+			}
+		}
+		bool result = this->open();
+		this->close();
+		return result;
+	}
+
 	void Source::close()
 	{
 		if (this->streamOpen)
@@ -91,10 +152,33 @@ namespace xal
 	{
 		if (this->streamOpen)
 		{
-			this->stream->rewind();
+			this->_seek(0, hsbase::START);
 		}
 	}
 	
+	bool Source::seek(int64_t samplePosition)
+	{
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		this->rewind();
+		// formats without random access have to decode and discard the data up to the sample
+		int64_t remaining = samplePosition * this->channels * this->bitsPerSample / 8;
+		hstream skipped;
+		int read = 0;
+		while (remaining > 0)
+		{
+			read = this->loadChunk(skipped, (int)hmin(remaining, (int64_t)STREAM_BUFFER_SIZE));
+			if (read <= 0)
+			{
+				return false;
+			}
+			remaining -= read;
+		}
+		return true;
+	}
+
 	bool Source::load(hstream& output)
 	{
 		hlog::write(xal::logTag, "Loading file: " + this->filename);
@@ -115,5 +199,113 @@ namespace xal
 		}
 		return 1; // means that "something" was read
 	}
-	
+
+	void Source::_setMemory(unsigned char* data, int64_t size)
+	{
+		this->memory.data = data;
+		this->memory.size = size;
+		this->memory.position = 0;
+	}
+
+	void Source::_readLoopComments(harray<hstr> comments)
+	{
+		this->loopStart = 0;
+		this->loopEnd = 0;
+		int64_t length = 0;
+		harray<hstr> data;
+		foreach (hstr, it, comments)
+		{
+			data = (*it).split("=", 1);
+			if (data.size() < 2)
+			{
+				continue;
+			}
+			// comment names are case-insensitive
+			data[0] = data[0].uppered();
+			if (data[0] == "LOOPSTART")
+			{
+				this->loopStart = hmax((int64_t)data[1], (int64_t)0);
+			}
+			else if (data[0] == "LOOPEND")
+			{
+				this->loopEnd = hmax((int64_t)data[1], (int64_t)0);
+			}
+			else if (data[0] == "LOOPLENGTH")
+			{
+				length = hmax((int64_t)data[1], (int64_t)0);
+			}
+		}
+		if (length > 0)
+		{
+			this->loopEnd = this->loopStart + length;
+		}
+	}
+
+	int Source::_readRaw(void* buffer, int count)
+	{
+		if (this->memory.data == NULL)
+		{
+			return this->stream->readRaw(buffer, count);
+		}
+		int read = (int)hclamp(this->memory.size - this->memory.position, (int64_t)0, (int64_t)count);
+		if (read > 0)
+		{
+			memcpy(buffer, &this->memory.data[this->memory.position], read);
+			this->memory.position += read;
+		}
+		return read;
+	}
+
+	void Source::_seek(int64_t offset, hsbase::SeekMode seekMode)
+	{
+		if (this->memory.data == NULL)
+		{
+			this->stream->seek(offset, seekMode);
+			return;
+		}
+		switch (seekMode)
+		{
+		case hsbase::CURRENT:
+			offset += this->memory.position;
+			break;
+		case hsbase::END:
+			offset += this->memory.size;
+			break;
+		default:
+			break;
+		}
+		this->memory.position = hclamp(offset, (int64_t)0, this->memory.size);
+	}
+
+	int64_t Source::_getPosition()
+	{
+		return (this->memory.data != NULL ? this->memory.position : this->stream->position());
+	}
+
+	bool Source::_isEof()
+	{
+		return (this->memory.data != NULL ? this->memory.position >= this->memory.size : this->stream->eof());
+	}
+
+	unsigned char* Source::_getMemoryData(int64_t* available)
+	{
+		if (!this->streamOpen)
+		{
+			return NULL;
+		}
+		if (this->memory.data != NULL)
+		{
+			*available = this->memory.size - this->memory.position;
+			return &this->memory.data[this->memory.position];
+		}
+		// data of RAM Sources is always in an hstream that is kept when closing, the copy of an ASYNC DISK Source is deleted
+		if (this->sourceMode == RAM)
+		{
+			hstream* stream = (hstream*)this->stream;
+			*available = stream->size() - stream->position();
+			return &((unsigned char*)(*stream))[stream->position()];
+		}
+		return NULL;
+	}
+
 }
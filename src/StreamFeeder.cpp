@@ -0,0 +1,228 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <hltypes/harray.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hthread.h>
+
+#include "Buffer.h"
+#include "Player.h"
+#include "StreamFeeder.h"
+#include "xal.h"
+
+namespace xal
+{
+	hmutex StreamFeeder::mutex;
+	harray<Player*> StreamFeeder::players;
+	hthread StreamFeeder::thread(&StreamFeeder::_feed, "XAL stream feeder");
+	bool StreamFeeder::running = false;
+	bool StreamFeeder::realTime = false;
+	int StreamFeeder::cpuAffinity = 0;
+	UpdateEvent StreamFeeder::event;
+	hmutex StreamFeeder::decoderMutex;
+	harray<Buffer*> StreamFeeder::buffers;
+	hthread StreamFeeder::decoderThread(&StreamFeeder::_decode, "XAL stream decoder");
+	bool StreamFeeder::decoding = false;
+	UpdateEvent StreamFeeder::decoderEvent;
+
+	void StreamFeeder::start(bool realTime, int cpuAffinity)
+	{
+		hmutex::ScopeLock lock(&StreamFeeder::mutex);
+		if (!StreamFeeder::running)
+		{
+			hlog::write(xal::logTag, "Starting stream feeder thread.");
+			StreamFeeder::realTime = realTime;
+			StreamFeeder::cpuAffinity = cpuAffinity;
+			StreamFeeder::running = true;
+			hmutex::ScopeLock decoderLock(&StreamFeeder::decoderMutex);
+			StreamFeeder::decoding = true;
+			decoderLock.release();
+			StreamFeeder::decoderThread.start();
+			StreamFeeder::thread.start();
+		}
+	}
+
+	void StreamFeeder::stop()
+	{
+		hmutex::ScopeLock lock(&StreamFeeder::mutex);
+		if (StreamFeeder::running)
+		{
+			hlog::write(xal::logTag, "Stopping stream feeder thread.");
+			StreamFeeder::running = false;
+			hmutex::ScopeLock decoderLock(&StreamFeeder::decoderMutex);
+			StreamFeeder::decoding = false;
+			StreamFeeder::buffers.clear();
+			decoderLock.release();
+			// the update thread refills these Players from now on so they have to load synchronously again
+			foreach (Player*, it, StreamFeeder::players)
+			{
+				(*it)->streamFed = false;
+				(*it)->buffer->_stopDecodeAhead();
+			}
+			StreamFeeder::players.clear();
+			StreamFeeder::event.signal();
+			StreamFeeder::decoderEvent.signal();
+			lock.release();
+			StreamFeeder::thread.join();
+			StreamFeeder::decoderThread.join();
+		}
+	}
+
+	bool StreamFeeder::isRunning()
+	{
+		hmutex::ScopeLock lock(&StreamFeeder::mutex);
+		return StreamFeeder::running;
+	}
+
+	bool StreamFeeder::_addPlayer(Player* player)
+	{
+		if (!StreamFeeder::running || !player->_systemSupportsStreamFeeding() ||
+			!player->buffer->_startDecodeAhead(player->streamBufferSize, player->streamBufferCount, player->looping))
+		{
+			return false;
+		}
+		StreamFeeder::players |= player;
+		player->streamFed = true;
+		hmutex::ScopeLock lock(&StreamFeeder::decoderMutex);
+		StreamFeeder::buffers |= player->buffer;
+		lock.release();
+		StreamFeeder::decoderEvent.signal();
+		StreamFeeder::event.signal();
+		return true;
+	}
+
+	void StreamFeeder::_removePlayer(Player* player)
+	{
+		if (!player->streamFed)
+		{
+			return;
+		}
+		StreamFeeder::players /= player;
+		player->streamFed = false;
+		hmutex::ScopeLock lock(&StreamFeeder::decoderMutex);
+		StreamFeeder::buffers /= player->buffer;
+		lock.release();
+		player->buffer->_stopDecodeAhead();
+	}
+
+	void StreamFeeder::_wakeDecoder()
+	{
+		StreamFeeder::decoderEvent.signal();
+	}
+
+	void StreamFeeder::_feed(hthread* thread)
+	{
+		StreamFeeder::_applyScheduling();
+		hmutex::ScopeLock lock;
+		int64_t lastTime = htickCount();
+		int64_t time = 0;
+		float timeDelta = 0.0f;
+		float delay = 0.0f;
+		while (true)
+		{
+			lock.acquire(&StreamFeeder::mutex);
+			if (!StreamFeeder::running)
+			{
+				break;
+			}
+			time = htickCount();
+			timeDelta = (time - lastTime) * 0.001f;
+			lastTime = time;
+			delay = -1.0f;
+			foreach (Player*, it, StreamFeeder::players)
+			{
+				(*it)->_feedStream(timeDelta);
+				delay = (delay >= 0.0f ? hmin(delay, (*it)->_calcFeedDelay()) : (*it)->_calcFeedDelay());
+			}
+			lock.release();
+			StreamFeeder::event.wait(delay);
+		}
+	}
+
+	void StreamFeeder::_decode(hthread* thread)
+	{
+		hmutex::ScopeLock lock;
+		bool decoded = false;
+		while (true)
+		{
+			lock.acquire(&StreamFeeder::decoderMutex);
+			if (!StreamFeeder::decoding)
+			{
+				break;
+			}
+			// one chunk per Buffer at a time so all fed Players are kept ahead evenly
+			decoded = false;
+			foreach (Buffer*, it, StreamFeeder::buffers)
+			{
+				if ((*it)->_decodeAhead())
+				{
+					decoded = true;
+				}
+			}
+			lock.release();
+			if (!decoded)
+			{
+				StreamFeeder::decoderEvent.wait(-1.0f);
+			}
+		}
+	}
+
+	void StreamFeeder::_applyScheduling()
+	{
+#ifdef _WIN32
+		if (StreamFeeder::realTime && !SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+		{
+			hlog::warn(xal::logTag, "Could not raise stream feeder thread priority.");
+		}
+#ifndef _WINRT
+		if (StreamFeeder::cpuAffinity != 0 && SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)StreamFeeder::cpuAffinity) == 0)
+		{
+			hlog::warn(xal::logTag, "Could not set stream feeder thread CPU affinity.");
+		}
+#endif
+#else
+		if (StreamFeeder::realTime)
+		{
+			struct sched_param parameters;
+			parameters.sched_priority = sched_get_priority_min(SCHED_FIFO);
+			if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters) != 0)
+			{
+				hlog::warn(xal::logTag, "Could not use real-time scheduling for stream feeder thread.");
+			}
+		}
+#ifdef __linux__ // includes Android
+		if (StreamFeeder::cpuAffinity != 0)
+		{
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			for_iter (i, 0, (int)sizeof(int) * 8)
+			{
+				if ((StreamFeeder::cpuAffinity >> i) & 1)
+				{
+					CPU_SET(i, &cpus);
+				}
+			}
+			if (sched_setaffinity(0, sizeof(cpu_set_t), &cpus) != 0)
+			{
+				hlog::warn(xal::logTag, "Could not set stream feeder thread CPU affinity.");
+			}
+		}
+#endif
+#endif
+	}
+
+}
@@ -0,0 +1,82 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a thread that refills streamed Players independently of the update thread and a thread that decodes their data ahead.
+
+#ifndef XAL_STREAM_FEEDER_H
+#define XAL_STREAM_FEEDER_H
+
+#include <hltypes/harray.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hthread.h>
+
+#include "UpdateEvent.h"
+#include "xalExport.h"
+
+namespace xal
+{
+	class Buffer;
+	class Player;
+
+	/// @brief Refills the queues of streamed Players on a separate thread so slow control operations don't delay them.
+	/// @note Only Players of audio-systems that support it are fed by this thread. Their data is decoded ahead by a second thread with normal priority so the feeder thread only copies it.
+	class StreamFeeder
+	{
+	public:
+		/// @brief Mutex that has to be locked while a fed Player's stream is accessed.
+		static hmutex mutex;
+
+		/// @brief Starts the feeder thread and the decoder thread.
+		/// @param[in] realTime Whether the thread should use a real-time scheduling policy.
+		/// @param[in] cpuAffinity Bit mask of the CPU cores on which the thread may run, 0 for no restriction.
+		static void start(bool realTime, int cpuAffinity);
+		/// @brief Stops the feeder thread and the decoder thread.
+		static void stop();
+		/// @return True if the feeder thread is running.
+		static bool isRunning();
+
+		/// @brief Adds a Player that is fed by the feeder thread.
+		/// @param[in] player The Player.
+		/// @return True if the Player is fed by the feeder thread.
+		/// @note The mutex has to be locked when calling this.
+		static bool _addPlayer(Player* player);
+		/// @brief Removes a Player from the feeder thread.
+		/// @param[in] player The Player.
+		/// @note The mutex has to be locked when calling this.
+		static void _removePlayer(Player* player);
+		/// @brief Wakes up the decoder thread because there is room to decode ahead.
+		static void _wakeDecoder();
+
+	protected:
+		static harray<Player*> players;
+		static hthread thread;
+		static bool running;
+		static bool realTime;
+		static int cpuAffinity;
+		static UpdateEvent event;
+		static hmutex decoderMutex;
+		static harray<Buffer*> buffers;
+		static hthread decoderThread;
+		static bool decoding;
+		static UpdateEvent decoderEvent;
+
+		static void _feed(hthread* thread);
+		static void _decode(hthread* thread);
+		static void _applyScheduling();
+
+	private: // prevents inheritance and instantiation
+		StreamFeeder() { }
+		~StreamFeeder() { }
+
+	};
+	
+}
+
+#endif
@@ -0,0 +1,113 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
+#include <hltypes/hltypesUtil.h>
+
+#include "UpdateEvent.h"
+
+namespace xal
+{
+#ifndef _WIN32
+	/// @brief Condition variable with the flag it guards.
+	struct _PosixEvent
+	{
+		pthread_mutex_t mutex;
+		pthread_cond_t condition;
+		bool signaled;
+	};
+#endif
+
+	UpdateEvent::UpdateEvent() : data(NULL)
+	{
+#ifdef _WIN32
+		// auto-reset event, available on WinRT as well
+		this->data = (void*)CreateEventExW(NULL, NULL, 0, EVENT_ALL_ACCESS);
+#else
+		_PosixEvent* event = new _PosixEvent();
+		pthread_mutex_init(&event->mutex, NULL);
+		pthread_cond_init(&event->condition, NULL);
+		event->signaled = false;
+		this->data = event;
+#endif
+	}
+
+	UpdateEvent::~UpdateEvent()
+	{
+#ifdef _WIN32
+		if (this->data != NULL)
+		{
+			CloseHandle((HANDLE)this->data);
+		}
+#else
+		_PosixEvent* event = (_PosixEvent*)this->data;
+		pthread_cond_destroy(&event->condition);
+		pthread_mutex_destroy(&event->mutex);
+		delete event;
+#endif
+	}
+
+	bool UpdateEvent::wait(float timeout)
+	{
+#ifdef _WIN32
+		DWORD milliseconds = (timeout >= 0.0f ? (DWORD)(timeout * 1000) : INFINITE);
+		return (WaitForSingleObjectEx((HANDLE)this->data, milliseconds, FALSE) == WAIT_OBJECT_0);
+#else
+		_PosixEvent* event = (_PosixEvent*)this->data;
+		pthread_mutex_lock(&event->mutex);
+		if (timeout >= 0.0f)
+		{
+			struct timeval now;
+			gettimeofday(&now, NULL);
+			int64_t nanoseconds = (int64_t)now.tv_usec * 1000 + (int64_t)(timeout * 1000000000.0);
+			struct timespec deadline;
+			deadline.tv_sec = now.tv_sec + (time_t)(nanoseconds / 1000000000);
+			deadline.tv_nsec = (long)(nanoseconds % 1000000000);
+			while (!event->signaled)
+			{
+				if (pthread_cond_timedwait(&event->condition, &event->mutex, &deadline) == ETIMEDOUT)
+				{
+					break;
+				}
+			}
+		}
+		else
+		{
+			while (!event->signaled)
+			{
+				pthread_cond_wait(&event->condition, &event->mutex);
+			}
+		}
+		bool result = event->signaled;
+		event->signaled = false;
+		pthread_mutex_unlock(&event->mutex);
+		return result;
+#endif
+	}
+
+	void UpdateEvent::signal()
+	{
+#ifdef _WIN32
+		SetEvent((HANDLE)this->data);
+#else
+		_PosixEvent* event = (_PosixEvent*)this->data;
+		pthread_mutex_lock(&event->mutex);
+		event->signaled = true;
+		pthread_cond_signal(&event->condition);
+		pthread_mutex_unlock(&event->mutex);
+#endif
+	}
+
+}
@@ -0,0 +1,45 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines an event on which the update thread sleeps.
+
+#ifndef XAL_UPDATE_EVENT_H
+#define XAL_UPDATE_EVENT_H
+
+#include "xalExport.h"
+
+namespace xal
+{
+	/// @brief Lets a thread sleep until a timeout passes or until another thread wakes it up.
+	class UpdateEvent
+	{
+	public:
+		/// @brief Constructor.
+		UpdateEvent();
+		/// @brief Destructor.
+		~UpdateEvent();
+
+		/// @brief Waits until the event is signaled or the timeout has passed.
+		/// @param[in] timeout Max time to wait in seconds.
+		/// @return True if the event was signaled.
+		/// @note A negative timeout value means indefinitely.
+		bool wait(float timeout);
+		/// @brief Signals the event.
+		/// @note If no thread is waiting, the next call of wait() returns immediately.
+		void signal();
+
+	protected:
+		/// @brief The operating system's synchronization data.
+		void* data;
+
+	};
+
+}
+#endif
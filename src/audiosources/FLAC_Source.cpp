@@ -7,13 +7,550 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _FORMAT_FLAC
+#include <string.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
+
 #include "FLAC_Source.h"
 #include "xal.h"
 
+#define FLAC_MAX_LPC_ORDER 32
+#define FLAC_CHANNEL_LEFT_SIDE 8
+#define FLAC_CHANNEL_RIGHT_SIDE 9
+#define FLAC_CHANNEL_MID_SIDE 10
+
 namespace xal
 {
+	/// @brief Header of an encoded frame.
+	struct FlacFrameHeader
+	{
+		int blockSize;
+		int channelAssignment;
+		int bitsPerSample;
+		/// @brief Frame number with fixed block sizes or sample number with variable block sizes.
+		int64_t number;
+		bool variableBlockSize;
+	};
+
+	/// @brief Reads bits from a byte buffer that has FLAC_INPUT_PADDING readable bytes after its end.
+	/// @note The limit is only checked between elements that have a bounded size so reading past it never leaves the padding.
+	struct FlacBitReader
+	{
+		const unsigned char* data;
+		int position;
+		int limit;
+	};
+
+	static struct FlacCrc8Table
+	{
+		unsigned char values[256];
+
+		FlacCrc8Table()
+		{
+			unsigned char crc = 0;
+			for_iter (i, 0, 256)
+			{
+				crc = (unsigned char)i;
+				for_iter (j, 0, 8)
+				{
+					crc = (unsigned char)((crc & 0x80) != 0 ? (crc << 1) ^ 0x07 : crc << 1);
+				}
+				this->values[i] = crc;
+			}
+		}
+
+	} crc8Table;
+
+	static inline unsigned int _readBits(FlacBitReader& reader, int count)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+		const unsigned char* data = &reader.data[reader.position >> 3];
+		uint64_t value = ((uint64_t)data[0] << 56) | ((uint64_t)data[1] << 48) | ((uint64_t)data[2] << 40) | ((uint64_t)data[3] << 32) |
+			((uint64_t)data[4] << 24) | ((uint64_t)data[5] << 16) | ((uint64_t)data[6] << 8) | (uint64_t)data[7];
+		value <<= (reader.position & 7);
+		reader.position += count;
+		return (unsigned int)(value >> (64 - count));
+	}
+
+	static inline int _readSignedBits(FlacBitReader& reader, int count)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+		return ((int)(_readBits(reader, count) << (32 - count)) >> (32 - count));
+	}
+
+	static inline unsigned int _readUnary(FlacBitReader& reader)
+	{
+		unsigned int count = 0;
+		unsigned int byte = 0;
+		while (reader.position < reader.limit)
+		{
+			byte = (reader.data[reader.position >> 3] << (reader.position & 7)) & 0xFF;
+			if (byte != 0)
+			{
+				while ((byte & 0x80) == 0)
+				{
+					byte <<= 1;
+					++count;
+					++reader.position;
+				}
+				++reader.position; // the terminating 1 bit
+				return count;
+			}
+			count += 8 - (reader.position & 7);
+			reader.position += 8 - (reader.position & 7);
+		}
+		reader.position = reader.limit + 1; // marks the overrun
+		return 0;
+	}
+
+	static inline int _readInt32LE(const unsigned char* data)
+	{
+		return (data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24));
+	}
+
+	/// @return The comments of a VORBIS_COMMENT block, all lengths are little endian unlike the rest of FLAC.
+	static harray<hstr> _readVorbisComments(const unsigned char* data, int size)
+	{
+		harray<hstr> result;
+		if (size < 4)
+		{
+			return result;
+		}
+		int position = 4 + _readInt32LE(data); // vendor string is skipped
+		if (position < 4 || position + 4 > size)
+		{
+			return result;
+		}
+		int count = _readInt32LE(&data[position]);
+		position += 4;
+		int length = 0;
+		for_iter (i, 0, count)
+		{
+			if (position + 4 > size)
+			{
+				break;
+			}
+			length = _readInt32LE(&data[position]);
+			position += 4;
+			if (length < 0 || position + length > size)
+			{
+				break;
+			}
+			result += hstr((const char*)&data[position], length);
+			position += length;
+		}
+		return result;
+	}
+
+	static bool _readFrameHeader(const unsigned char* data, int size, int bitsPerSample, FlacFrameHeader& header, int* headerSize)
+	{
+		if (size < 6 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8)
+		{
+			return false;
+		}
+		FlacBitReader reader;
+		reader.data = data;
+		reader.position = 15;
+		reader.limit = size * 8;
+		header.variableBlockSize = (_readBits(reader, 1) != 0);
+		int blockSizeCode = _readBits(reader, 4);
+		int samplingRateCode = _readBits(reader, 4);
+		header.channelAssignment = _readBits(reader, 4);
+		int bitsPerSampleCode = _readBits(reader, 3);
+		if (_readBits(reader, 1) != 0 || blockSizeCode == 0 || samplingRateCode == 15 || header.channelAssignment > FLAC_CHANNEL_MID_SIDE ||
+			bitsPerSampleCode == 3)
+		{
+			return false;
+		}
+		// frame or sample number, UTF-8 coded
+		unsigned int byte = _readBits(reader, 8);
+		int ones = 0;
+		while (ones < 8 && (byte & (0x80 >> ones)) != 0)
+		{
+			++ones;
+		}
+		if (ones == 1 || ones == 8)
+		{
+			return false;
+		}
+		header.number = byte & (0x7F >> ones);
+		for_iter (i, 1, ones)
+		{
+			byte = _readBits(reader, 8);
+			if ((byte & 0xC0) != 0x80)
+			{
+				return false;
+			}
+			header.number = (header.number << 6) | (byte & 0x3F);
+		}
+		if (blockSizeCode == 1)
+		{
+			header.blockSize = 192;
+		}
+		else if (blockSizeCode <= 5)
+		{
+			header.blockSize = 576 << (blockSizeCode - 2);
+		}
+		else if (blockSizeCode == 6)
+		{
+			header.blockSize = _readBits(reader, 8) + 1;
+		}
+		else if (blockSizeCode == 7)
+		{
+			header.blockSize = _readBits(reader, 16) + 1;
+		}
+		else
+		{
+			header.blockSize = 256 << (blockSizeCode - 8);
+		}
+		// the sampling rate is not needed for decoding, it only has to be skipped
+		if (samplingRateCode == 12)
+		{
+			_readBits(reader, 8);
+		}
+		else if (samplingRateCode == 13 || samplingRateCode == 14)
+		{
+			_readBits(reader, 16);
+		}
+		static int sampleSizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+		header.bitsPerSample = (bitsPerSampleCode == 0 ? bitsPerSample : sampleSizes[bitsPerSampleCode]);
+		int crcPosition = reader.position >> 3;
+		if (crcPosition >= size)
+		{
+			return false;
+		}
+		unsigned char crc = 0;
+		for_iter (i, 0, crcPosition)
+		{
+			crc = crc8Table.values[crc ^ data[i]];
+		}
+		if (crc != data[crcPosition])
+		{
+			return false;
+		}
+		*headerSize = crcPosition + 1;
+		return true;
+	}
+
+	static bool _decodeResidual(FlacBitReader& reader, int blockSize, int order, int* output)
+	{
+		int method = _readBits(reader, 2);
+		if (method > 1)
+		{
+			return false;
+		}
+		int parameterBits = (method == 0 ? 4 : 5);
+		int escapeCode = (method == 0 ? 15 : 31);
+		int partitionOrder = _readBits(reader, 4);
+		int partitionSize = blockSize >> partitionOrder;
+		if ((partitionSize << partitionOrder) != blockSize || partitionSize < order)
+		{
+			return false;
+		}
+		output += order;
+		int count = 0;
+		int parameter = 0;
+		unsigned int value = 0;
+		for_iter (i, 0, 1 << partitionOrder)
+		{
+			count = (i == 0 ? partitionSize - order : partitionSize);
+			parameter = _readBits(reader, parameterBits);
+			if (parameter == escapeCode)
+			{
+				parameter = _readBits(reader, 5);
+				for_iter (j, 0, count)
+				{
+					output[j] = _readSignedBits(reader, parameter);
+					if (reader.position > reader.limit)
+					{
+						return false;
+					}
+				}
+			}
+			else
+			{
+				for_iter (j, 0, count)
+				{
+					value = (_readUnary(reader) << parameter);
+					if (reader.position > reader.limit)
+					{
+						return false;
+					}
+					value |= _readBits(reader, parameter);
+					output[j] = (int)(value >> 1) ^ -(int)(value & 1);
+				}
+			}
+			output += count;
+		}
+		return (reader.position <= reader.limit);
+	}
+
+	static void _restoreFixed(int* samples, int blockSize, int order)
+	{
+		switch (order)
+		{
+		case 1:
+			for_iter (i, 1, blockSize)
+			{
+				samples[i] += samples[i - 1];
+			}
+			break;
+		case 2:
+			for_iter (i, 2, blockSize)
+			{
+				samples[i] += 2 * samples[i - 1] - samples[i - 2];
+			}
+			break;
+		case 3:
+			for_iter (i, 3, blockSize)
+			{
+				samples[i] += 3 * (samples[i - 1] - samples[i - 2]) + samples[i - 3];
+			}
+			break;
+		case 4:
+			for_iter (i, 4, blockSize)
+			{
+				samples[i] += 4 * (samples[i - 1] + samples[i - 3]) - 6 * samples[i - 2] - samples[i - 4];
+			}
+			break;
+		}
+	}
+
+	/// @note Coefficients are stored in reverse order so the prediction is a dot product over contiguous memory which compilers can vectorize.
+	static void _restoreLpc(int* samples, int blockSize, const int* coefficients, int order, int shift, bool wide)
+	{
+		const int* history = samples;
+		if (!wide)
+		{
+			int sum = 0;
+			for_iter (i, order, blockSize)
+			{
+				history = &samples[i - order];
+				sum = 0;
+				for_iter (j, 0, order)
+				{
+					sum += coefficients[j] * history[j];
+				}
+				samples[i] += (sum >> shift);
+			}
+			return;
+		}
+		int64_t sum = 0;
+		for_iter (i, order, blockSize)
+		{
+			history = &samples[i - order];
+			sum = 0;
+			for_iter (j, 0, order)
+			{
+				sum += (int64_t)coefficients[j] * history[j];
+			}
+			samples[i] += (int)(sum >> shift);
+		}
+	}
+
+	static bool _decodeSubframe(FlacBitReader& reader, int blockSize, int bitsPerSample, int* output)
+	{
+		if (_readBits(reader, 1) != 0)
+		{
+			return false;
+		}
+		int type = _readBits(reader, 6);
+		int wastedBits = 0;
+		if (_readBits(reader, 1) != 0)
+		{
+			wastedBits = _readUnary(reader) + 1;
+			bitsPerSample -= wastedBits;
+		}
+		if (bitsPerSample <= 0 || bitsPerSample > 32 || reader.position > reader.limit)
+		{
+			return false;
+		}
+		if (type == 0) // constant
+		{
+			int value = _readSignedBits(reader, bitsPerSample);
+			for_iter (i, 0, blockSize)
+			{
+				output[i] = value;
+			}
+		}
+		else if (type == 1) // verbatim
+		{
+			for_iter (i, 0, blockSize)
+			{
+				output[i] = _readSignedBits(reader, bitsPerSample);
+				if (reader.position > reader.limit)
+				{
+					return false;
+				}
+			}
+		}
+		else if (type >= 8 && type <= 12) // fixed prediction
+		{
+			int order = type - 8;
+			if (order > blockSize)
+			{
+				return false;
+			}
+			for_iter (i, 0, order)
+			{
+				output[i] = _readSignedBits(reader, bitsPerSample);
+			}
+			if (reader.position > reader.limit || !_decodeResidual(reader, blockSize, order, output))
+			{
+				return false;
+			}
+			_restoreFixed(output, blockSize, order);
+		}
+		else if (type >= 32) // linear prediction
+		{
+			int order = (type & 0x1F) + 1;
+			if (order > blockSize)
+			{
+				return false;
+			}
+			for_iter (i, 0, order)
+			{
+				output[i] = _readSignedBits(reader, bitsPerSample);
+			}
+			if (reader.position > reader.limit)
+			{
+				return false;
+			}
+			int precision = _readBits(reader, 4) + 1;
+			int shift = _readSignedBits(reader, 5);
+			if (precision == 16 || shift < 0)
+			{
+				return false;
+			}
+			int coefficients[FLAC_MAX_LPC_ORDER];
+			for_iter (i, 0, order)
+			{
+				coefficients[order - 1 - i] = _readSignedBits(reader, precision);
+			}
+			if (!_decodeResidual(reader, blockSize, order, output))
+			{
+				return false;
+			}
+			int orderBits = 0;
+			while ((1 << orderBits) < order)
+			{
+				++orderBits;
+			}
+			_restoreLpc(output, blockSize, coefficients, order, shift, (bitsPerSample + precision + orderBits > 32));
+		}
+		else
+		{
+			return false;
+		}
+		if (wastedBits > 0)
+		{
+			for_iter (i, 0, blockSize)
+			{
+				output[i] <<= wastedBits;
+			}
+		}
+		return true;
+	}
+
+	/// @return Size of the frame in bytes or 0 if the frame could not be decoded.
+	static int _decodeFrame(const unsigned char* data, int size, int channels, int bitsPerSample, int maxBlockSize,
+		int* output, FlacFrameHeader& header)
+	{
+		int headerSize = 0;
+		if (!_readFrameHeader(data, size, bitsPerSample, header, &headerSize) || header.blockSize > maxBlockSize ||
+			header.bitsPerSample != bitsPerSample)
+		{
+			return 0;
+		}
+		int frameChannels = (header.channelAssignment < FLAC_CHANNEL_LEFT_SIDE ? header.channelAssignment + 1 : 2);
+		if (frameChannels != channels)
+		{
+			return 0;
+		}
+		FlacBitReader reader;
+		reader.data = data;
+		reader.position = headerSize * 8;
+		reader.limit = size * 8;
+		int blockSize = header.blockSize;
+		int subframeBitsPerSample = 0;
+		for_iter (i, 0, channels)
+		{
+			// the side channel has one additional bit
+			subframeBitsPerSample = bitsPerSample;
+			if ((header.channelAssignment == FLAC_CHANNEL_LEFT_SIDE && i == 1) || (header.channelAssignment == FLAC_CHANNEL_RIGHT_SIDE && i == 0) ||
+				(header.channelAssignment == FLAC_CHANNEL_MID_SIDE && i == 1))
+			{
+				++subframeBitsPerSample;
+			}
+			if (!_decodeSubframe(reader, blockSize, subframeBitsPerSample, &output[i * maxBlockSize]))
+			{
+				return 0;
+			}
+		}
+		// stereo decorrelation
+		int* left = output;
+		int* right = &output[maxBlockSize];
+		int mid = 0;
+		int side = 0;
+		switch (header.channelAssignment)
+		{
+		case FLAC_CHANNEL_LEFT_SIDE:
+			for_iter (i, 0, blockSize)
+			{
+				right[i] = left[i] - right[i];
+			}
+			break;
+		case FLAC_CHANNEL_RIGHT_SIDE:
+			for_iter (i, 0, blockSize)
+			{
+				left[i] += right[i];
+			}
+			break;
+		case FLAC_CHANNEL_MID_SIDE:
+			for_iter (i, 0, blockSize)
+			{
+				side = right[i];
+				mid = (left[i] << 1) | (side & 1);
+				left[i] = (mid + side) >> 1;
+				right[i] = (mid - side) >> 1;
+			}
+			break;
+		}
+		// byte alignment and CRC-16
+		reader.position = ((reader.position + 7) & ~7) + 16;
+		if (reader.position > reader.limit)
+		{
+			return 0;
+		}
+		return (reader.position >> 3);
+	}
+
 	FLAC_Source::FLAC_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
 	{
+		this->sourceBitsPerSample = 0;
+		this->minBlockSize = 0;
+		this->maxBlockSize = 0;
+		this->maxFrameSize = 0;
+		this->totalSamples = 0;
+		this->firstFrameOffset = 0;
+		this->inputData = NULL;
+		this->inputCapacity = 0;
+		this->inputSize = 0;
+		this->inputPosition = 0;
+		this->inputEof = false;
+		this->decodedData = NULL;
+		this->blockSamples = NULL;
+		this->blockFrames = 0;
+		this->blockPosition = 0;
+		this->seekTarget = -1;
 	}
 
 	FLAC_Source::~FLAC_Source()
@@ -28,26 +565,303 @@ namespace xal
 		{
 			return false;
 		}
-		// TODO - implement
+		if (!this->_readMetaData())
+		{
+			this->close();
+			return false;
+		}
+		// a frame can't be larger than its samples stored verbatim plus headers
+		int frameSize = this->maxFrameSize;
+		if (frameSize == 0)
+		{
+			frameSize = this->maxBlockSize * this->channels * (this->sourceBitsPerSample + 1) / 8 + 64;
+		}
+		this->inputCapacity = hmax(frameSize * 2, FLAC_INPUT_BUFFER_SIZE);
+		this->inputData = new unsigned char[this->inputCapacity + FLAC_INPUT_PADDING];
+		memset(&this->inputData[this->inputCapacity], 0, FLAC_INPUT_PADDING);
+		this->decodedData = new int[this->maxBlockSize * this->channels];
+		this->blockSamples = new short[this->maxBlockSize * this->channels];
+		this->rewind();
 		return this->streamOpen;
 	}
 
 	void FLAC_Source::close()
 	{
-		if (this->streamOpen)
+		if (this->inputData != NULL)
 		{
-			this->streamOpen = false;
-			// TODO - implement
+			delete [] this->inputData;
+			this->inputData = NULL;
+		}
+		if (this->decodedData != NULL)
+		{
+			delete [] this->decodedData;
+			this->decodedData = NULL;
+		}
+		if (this->blockSamples != NULL)
+		{
+			delete [] this->blockSamples;
+			this->blockSamples = NULL;
 		}
 		Source::close();
 	}
 
+	bool FLAC_Source::_readMetaData()
+	{
+		// data will be reloaded, clearing it here
+		this->channels = 0;
+		this->samplingRate = 0;
+		this->bitsPerSample = 0;
+		this->size = 0;
+		this->duration = 0.0f;
+		this->sourceBitsPerSample = 0;
+		this->minBlockSize = 0;
+		this->maxBlockSize = 0;
+		this->maxFrameSize = 0;
+		this->totalSamples = 0;
+		this->seekPoints.clear();
+		this->loopStart = 0;
+		this->loopEnd = 0;
+		unsigned char buffer[34] = {0};
+		this->_readRaw(buffer, 4);
+		// ID3v2 tags are sometimes prepended
+		if (memcmp(buffer, "ID3", 3) == 0)
+		{
+			this->_readRaw(buffer, 6);
+			int tagSize = (buffer[2] << 21) | (buffer[3] << 14) | (buffer[4] << 7) | buffer[5];
+			this->_seek(tagSize + ((buffer[1] & 0x10) != 0 ? 10 : 0));
+			this->_readRaw(buffer, 4);
+		}
+		if (memcmp(buffer, "fLaC", 4) != 0)
+		{
+			return false;
+		}
+		bool streamInfoFound = false;
+		bool last = false;
+		int type = 0;
+		int size = 0;
+		SeekPoint seekPoint;
+		while (!last)
+		{
+			if (this->_readRaw(buffer, 4) < 4)
+			{
+				return false;
+			}
+			last = ((buffer[0] & 0x80) != 0);
+			type = (buffer[0] & 0x7F);
+			size = (buffer[1] << 16) | (buffer[2] << 8) | buffer[3];
+			if (type == 0 && size >= 34) // STREAMINFO
+			{
+				this->_readRaw(buffer, 34);
+				size -= 34;
+				this->minBlockSize = (buffer[0] << 8) | buffer[1];
+				this->maxBlockSize = (buffer[2] << 8) | buffer[3];
+				this->maxFrameSize = (buffer[7] << 16) | (buffer[8] << 8) | buffer[9];
+				this->samplingRate = (buffer[10] << 12) | (buffer[11] << 4) | (buffer[12] >> 4);
+				this->channels = ((buffer[12] >> 1) & 0x7) + 1;
+				this->sourceBitsPerSample = (((buffer[12] & 0x1) << 4) | (buffer[13] >> 4)) + 1;
+				this->totalSamples = ((int64_t)(buffer[13] & 0xF) << 32) | ((int64_t)buffer[14] << 24) | (buffer[15] << 16) | (buffer[16] << 8) | buffer[17];
+				streamInfoFound = true;
+			}
+			else if (type == 3) // SEEKTABLE
+			{
+				while (size >= 18)
+				{
+					this->_readRaw(buffer, 18);
+					size -= 18;
+					seekPoint.sample = 0;
+					seekPoint.offset = 0;
+					for_iter (i, 0, 8)
+					{
+						seekPoint.sample = (seekPoint.sample << 8) | buffer[i];
+						seekPoint.offset = (seekPoint.offset << 8) | buffer[i + 8];
+					}
+					if (seekPoint.sample >= 0) // placeholders are all 1 bits
+					{
+						this->seekPoints += seekPoint;
+					}
+				}
+			}
+			else if (type == 4 && size > 0) // VORBIS_COMMENT
+			{
+				unsigned char* data = new unsigned char[size];
+				int read = this->_readRaw(data, size);
+				size = 0;
+				this->_readLoopComments(_readVorbisComments(data, read));
+				delete [] data;
+			}
+			if (size > 0)
+			{
+				this->_seek(size);
+			}
+		}
+		this->firstFrameOffset = this->_getPosition();
+		if (!streamInfoFound || this->samplingRate == 0 || this->maxBlockSize < 16 || this->sourceBitsPerSample < 4)
+		{
+			return false;
+		}
+		if (this->totalSamples == 0)
+		{
+			hlog::warn(xal::logTag, "FLAC file without sample count is not supported: " + this->filename);
+			return false;
+		}
+		this->bitsPerSample = 16;
+		this->size = (int)(this->totalSamples * this->channels * 2);
+		this->duration = (float)((double)this->totalSamples / this->samplingRate);
+		return true;
+	}
+
 	void FLAC_Source::rewind()
 	{
 		if (this->streamOpen)
 		{
-			// TODO - implement
+			this->_seekPcm(0);
+		}
+	}
+
+	bool FLAC_Source::seek(int64_t samplePosition)
+	{
+		return (this->streamOpen && this->_seekPcm(samplePosition));
+	}
+
+	bool FLAC_Source::_seekPcm(int64_t samplePosition)
+	{
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		SeekPoint seekPoint;
+		seekPoint.sample = 0;
+		seekPoint.offset = 0;
+		// seek points are sorted
+		foreach (SeekPoint, it, this->seekPoints)
+		{
+			if ((*it).sample > samplePosition)
+			{
+				break;
+			}
+			seekPoint = (*it);
+		}
+		this->_seek(this->firstFrameOffset + seekPoint.offset, hsbase::START);
+		this->inputSize = 0;
+		this->inputPosition = 0;
+		this->inputEof = false;
+		this->blockFrames = 0;
+		this->blockPosition = 0;
+		this->seekTarget = samplePosition;
+		return true;
+	}
+
+	void FLAC_Source::_fillInput()
+	{
+		if (this->inputPosition > 0)
+		{
+			this->inputSize -= this->inputPosition;
+			memmove(this->inputData, &this->inputData[this->inputPosition], this->inputSize);
+			this->inputPosition = 0;
+		}
+		int read = this->_readRaw(&this->inputData[this->inputSize], this->inputCapacity - this->inputSize);
+		if (read < this->inputCapacity - this->inputSize)
+		{
+			this->inputEof = true;
+		}
+		this->inputSize += hmax(read, 0);
+		// keeps the bit reader from using stale data past the end
+		memset(&this->inputData[this->inputSize], 0, FLAC_INPUT_PADDING);
+	}
+
+	bool FLAC_Source::_decodeNextFrame()
+	{
+		FlacFrameHeader header;
+		int frameSize = 0;
+		int available = 0;
+		int64_t firstSample = 0;
+		while (true)
+		{
+			available = this->inputSize - this->inputPosition;
+			if (!this->inputEof && available < this->inputCapacity / 2)
+			{
+				this->_fillInput();
+				available = this->inputSize;
+			}
+			if (available <= 0)
+			{
+				return false;
+			}
+			frameSize = _decodeFrame(&this->inputData[this->inputPosition], available, this->channels, this->sourceBitsPerSample,
+				this->maxBlockSize, this->decodedData, header);
+			if (frameSize == 0)
+			{
+				// corrupted data, searching for the next frame
+				++this->inputPosition;
+				while (this->inputPosition < this->inputSize - 1 && (this->inputData[this->inputPosition] != 0xFF || (this->inputData[this->inputPosition + 1] & 0xFE) != 0xF8))
+				{
+					++this->inputPosition;
+				}
+				if (this->inputEof && this->inputPosition >= this->inputSize - 1)
+				{
+					this->inputPosition = this->inputSize;
+					return false;
+				}
+				continue;
+			}
+			this->inputPosition += frameSize;
+			this->blockFrames = header.blockSize;
+			this->blockPosition = 0;
+			if (this->seekTarget >= 0)
+			{
+				firstSample = (header.variableBlockSize ? header.number : header.number * this->minBlockSize);
+				if (firstSample + header.blockSize <= this->seekTarget)
+				{
+					continue;
+				}
+				this->blockPosition = (int)hmax(this->seekTarget - firstSample, (int64_t)0);
+				this->seekTarget = -1;
+			}
+			break;
+		}
+		// conversion to interleaved 16 bit
+		int shift = this->sourceBitsPerSample - 16;
+		int* input = NULL;
+		short* output = NULL;
+		for_iter (i, 0, this->channels)
+		{
+			input = &this->decodedData[i * this->maxBlockSize];
+			output = &this->blockSamples[i];
+			if (shift > 0)
+			{
+				for_iter (j, 0, this->blockFrames)
+				{
+					output[j * this->channels] = (short)(input[j] >> shift);
+				}
+			}
+			else
+			{
+				for_iter (j, 0, this->blockFrames)
+				{
+					output[j * this->channels] = (short)(input[j] << -shift);
+				}
+			}
 		}
+		return true;
+	}
+
+	int FLAC_Source::_decode(char* output, int size)
+	{
+		int frameSize = this->channels * 2;
+		int written = 0;
+		int count = 0;
+		while (written + frameSize <= size)
+		{
+			if (this->blockPosition >= this->blockFrames && !this->_decodeNextFrame())
+			{
+				break;
+			}
+			count = hmin(this->blockFrames - this->blockPosition, (size - written) / frameSize);
+			memcpy(&output[written], &this->blockSamples[this->blockPosition * this->channels], count * frameSize);
+			this->blockPosition += count;
+			written += count * frameSize;
+		}
+		return written;
 	}
 
 	bool FLAC_Source::load(hstream& output)
@@ -56,8 +870,14 @@ namespace xal
 		{
 			return false;
 		}
-		// TODO - implement
-		return true;
+		output.prepareManualWriteRaw(this->size);
+		char* buffer = (char*)output;
+		int written = this->_decode(buffer, this->size);
+		if (written < this->size)
+		{
+			memset(&buffer[written], 0, this->size - written);
+		}
+		return (written > 0);
 	}
 
 	int FLAC_Source::loadChunk(hstream& output, int size)
@@ -66,8 +886,10 @@ namespace xal
 		{
 			return 0;
 		}
-		// TODO - implement
-		return 0;
+		output.prepareManualWriteRaw(size);
+		int written = this->_decode((char*)output, size);
+		output.truncate((int64_t)written); // if there wasn't enough data to fill the entire ouput buffer
+		return written;
 	}
 
 }
@@ -14,11 +14,16 @@
 #ifndef XAL_FLAC_SOURCE_H
 #define XAL_FLAC_SOURCE_H
 
+#include <hltypes/harray.h>
 #include <hltypes/hstring.h>
 
+#include "AudioManager.h"
 #include "Source.h"
 #include "xalExport.h"
 
+#define FLAC_INPUT_BUFFER_SIZE 65536
+#define FLAC_INPUT_PADDING 256
+
 namespace xal
 {
 	class xalExport FLAC_Source : public Source
@@ -30,9 +35,74 @@ namespace xal
 		bool open();
 		void close();
 		void rewind();
+		bool seek(int64_t samplePosition);
 		bool load(hstream& output);
 		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
 
+	protected:
+		/// @brief An entry of the SEEKTABLE meta-data block.
+		struct SeekPoint
+		{
+			/// @brief First sample of the target frame.
+			int64_t sample;
+			/// @brief Byte offset of the target frame relative to the first frame.
+			int64_t offset;
+		};
+
+		/// @brief Bits per sample of the encoded data.
+		int sourceBitsPerSample;
+		/// @brief Minimum block size in samples.
+		int minBlockSize;
+		/// @brief Maximum block size in samples.
+		int maxBlockSize;
+		/// @brief Maximum size of one encoded frame in bytes.
+		int maxFrameSize;
+		/// @brief Total number of samples per channel.
+		int64_t totalSamples;
+		/// @brief Position of the first frame in the file.
+		int64_t firstFrameOffset;
+		/// @brief Seek points from the SEEKTABLE.
+		harray<SeekPoint> seekPoints;
+		/// @brief Buffer for encoded data.
+		unsigned char* inputData;
+		/// @brief Capacity of the encoded data buffer.
+		int inputCapacity;
+		/// @brief Number of bytes currently in the encoded data buffer.
+		int inputSize;
+		/// @brief Current read position in the encoded data buffer.
+		int inputPosition;
+		/// @brief Whether the end of the file was reached while filling the encoded data buffer.
+		bool inputEof;
+		/// @brief Decoded samples of the current frame, one block for each channel.
+		int* decodedData;
+		/// @brief Decoded samples of the current frame, interleaved and converted to 16 bit.
+		short* blockSamples;
+		/// @brief Number of sample frames in the current frame.
+		int blockFrames;
+		/// @brief Number of sample frames already consumed from the current frame.
+		int blockPosition;
+		/// @brief Sample that needs to be reached after seeking or -1.
+		int64_t seekTarget;
+
+		/// @brief Reads STREAMINFO, SEEKTABLE and the loop points from VORBIS_COMMENT in the meta-data blocks.
+		/// @return True if the data is in a supported format.
+		bool _readMetaData();
+		/// @brief Refills the encoded data buffer.
+		void _fillInput();
+		/// @brief Decodes the next frame.
+		/// @return True if a frame was decoded.
+		bool _decodeNextFrame();
+		/// @brief Decodes data into 16 bit PCM.
+		/// @param[in] output Output buffer.
+		/// @param[in] size Size of the output buffer in bytes.
+		/// @return Number of bytes written.
+		int _decode(char* output, int size);
+		/// @brief Seeks to a sample by jumping to the closest preceding seek point.
+		/// @param[in] samplePosition The sample to seek to.
+		/// @return True if seeking was successful.
+		/// @note Frames between the seek point and the sample are decoded and discarded, without a SEEKTABLE decoding starts at the first frame.
+		bool _seekPcm(int64_t samplePosition);
+
 	};
 
 }
@@ -8,24 +8,66 @@
 
 #ifdef _FORMAT_OGG
 #include <stdio.h>
+#include <string.h>
 #include <ogg/ogg.h>
 #include <vorbis/codec.h>
 #include <vorbis/vorbisfile.h>
 
+#include <hltypes/harray.h>
 #include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
+#include <hltypes/hmutex.h>
 #include <hltypes/hresource.h>
 #include <hltypes/hstream.h>
+#include <hltypes/hthread.h>
 
 #include "AudioManager.h"
+#include "BufferAsync.h"
 #include "OGG_Source.h"
 #include "xal.h"
 
+// minimum duration of one segment when decoding in parallel, shorter files are always decoded serially
+#define PARALLEL_DECODE_MIN_SEGMENT_DURATION 10.0f
+// size of an Ogg page header without the segment table
+#define OGG_PAGE_HEADER_SIZE 27
+// maximum size of an Ogg page, the last page always starts within this many bytes from the end
+#define OGG_PAGE_MAX_SIZE 65307
+
 namespace xal
 {
 	// small optimization, it's not thread-safe, but since it's not used anywhere, it doesn't matter
 	static int _section = 0;
 
+	/// @brief A range of samples that is decoded independently from the rest of the file.
+	struct _DecodeSegment
+	{
+		MemoryView view;
+		ogg_int64_t start;
+		ogg_int64_t end;
+		int channels;
+		char* output;
+	};
+
+	/// @brief The segments of one load that haven't been taken by a decoding thread yet.
+	struct _DecodeQueue
+	{
+		harray<_DecodeSegment*> segments;
+		hmutex mutex;
+	};
+
+	/// @brief A thread that works on the queue of one load.
+	class _DecodeThread : public hthread
+	{
+	public:
+		_DecodeQueue* queue;
+
+		_DecodeThread(void (*function)(hthread*), _DecodeQueue* queue) : hthread(function, "XAL OGG decoder"), queue(queue)
+		{
+		}
+
+	};
+
 	static size_t _dataRead(void* data, size_t size, size_t count, void* dataSource)
 	{
 		hsbase* stream = (hsbase*)dataSource;
@@ -61,13 +103,111 @@ namespace xal
 		return (long)((hsbase*)dataSource)->position();
 	}
 
+	static size_t _memoryRead(void* data, size_t size, size_t count, void* dataSource)
+	{
+		MemoryView* view = (MemoryView*)dataSource;
+		int64_t read = hmin((int64_t)(size * count), view->size - view->position);
+		if (read <= 0)
+		{
+			return 0;
+		}
+		memcpy(data, &view->data[view->position], (size_t)read);
+		view->position += read;
+		return (size_t)read;
+	}
+
+	static int _memorySeek(void* dataSource, ogg_int64_t offset, int whence)
+	{
+		MemoryView* view = (MemoryView*)dataSource;
+		switch (whence)
+		{
+		case SEEK_CUR:
+			offset += view->position;
+			break;
+		case SEEK_END:
+			offset += view->size;
+			break;
+		}
+		view->position = (int64_t)hclamp(offset, (ogg_int64_t)0, (ogg_int64_t)view->size);
+		return 0;
+	}
+
+	static long _memoryTell(void* dataSource)
+	{
+		return (long)((MemoryView*)dataSource)->position;
+	}
+
+	static void _decodeSegment(_DecodeSegment* segment)
+	{
+		ov_callbacks callbacks;
+		callbacks.read_func = &_memoryRead;
+		callbacks.seek_func = &_memorySeek;
+		callbacks.close_func = &_dataClose;
+		callbacks.tell_func = &_memoryTell;
+		int remaining = (int)(segment->end - segment->start) * segment->channels * 2;
+		char* buffer = segment->output;
+		OggVorbis_File oggStream;
+		if (ov_open_callbacks((void*)&segment->view, &oggStream, NULL, 0, callbacks) == 0)
+		{
+			int section = 0;
+			int read = 0;
+			// ov_pcm_seek() decodes the preceding packet as well so the MDCT overlap at the segment start is identical to a serial decode
+			if (ov_pcm_seek(&oggStream, segment->start) == 0)
+			{
+				while (remaining > 0)
+				{
+					read = (int)ov_read(&oggStream, buffer, remaining, 0, 2, 1, &section);
+					if (read == OV_HOLE)
+					{
+						continue;
+					}
+					if (read <= 0)
+					{
+						break;
+					}
+					remaining -= read;
+					buffer += read;
+				}
+			}
+			ov_clear(&oggStream);
+		}
+		if (remaining > 0)
+		{
+			hlog::error(xal::logTag, "OGG: error decoding segment!");
+			memset(buffer, 0, remaining);
+		}
+	}
+
+	static void _decodeQueuedSegments(_DecodeQueue* queue)
+	{
+		_DecodeSegment* segment = NULL;
+		hmutex::ScopeLock lock(&queue->mutex);
+		while (queue->segments.size() > 0)
+		{
+			segment = queue->segments.removeFirst();
+			lock.release();
+			_decodeSegment(segment);
+			lock.acquire(&queue->mutex);
+		}
+	}
+
+	static void _decodeQueuedSegmentsThread(hthread* thread)
+	{
+		_decodeQueuedSegments(((_DecodeThread*)thread)->queue);
+	}
+
+	hmap<hstr, OGG_Source::PageIndex*> OGG_Source::pageIndices;
+	hmutex OGG_Source::pageIndicesMutex;
+
 	OGG_Source::OGG_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
 	{
+		this->pageIndex = NULL;
 	}
 
 	OGG_Source::~OGG_Source()
 	{
 		this->close();
+		this->_releasePageIndex();
 	}
 
 	bool OGG_Source::open()
@@ -83,7 +223,15 @@ namespace xal
 		callbacks.seek_func = &_dataSeek;
 		callbacks.close_func = &_dataClose; // may not be NULL because it may crash on Android otherwise
 		callbacks.tell_func = &_dataTell;
-		if (ov_open_callbacks((void*)this->stream, &this->oggStream, NULL, 0, callbacks) == 0)
+		void* dataSource = (void*)this->stream;
+		if (this->memory.data != NULL)
+		{
+			callbacks.read_func = &_memoryRead;
+			callbacks.seek_func = &_memorySeek;
+			callbacks.tell_func = &_memoryTell;
+			dataSource = (void*)&this->memory;
+		}
+		if (ov_open_callbacks(dataSource, &this->oggStream, NULL, 0, callbacks) == 0)
 		{
 			vorbis_info* info = ov_info(&this->oggStream, -1);
 			this->channels = (int)info->channels;
@@ -92,7 +240,22 @@ namespace xal
 			int logicalSamples = (int)ov_pcm_total(&this->oggStream, -1);
 			this->size = logicalSamples * this->channels * this->bitsPerSample / 8;
 			this->duration = (float)logicalSamples / this->samplingRate;
-			ov_pcm_seek(&this->oggStream, 0); // make sure the PCM stream is at the beginning to avoid nasty surprises
+			vorbis_comment* comment = ov_comment(&this->oggStream, -1);
+			harray<hstr> comments;
+			if (comment != NULL)
+			{
+				for_iter (i, 0, comment->comments)
+				{
+					comments += hstr(comment->user_comments[i], comment->comment_lengths[i]);
+				}
+			}
+			this->_readLoopComments(comments);
+			// only streamed data is seeked repeatedly, chained streams can't be indexed reliably
+			if (this->bufferMode == STREAMED && this->pageIndex == NULL && ov_seekable(&this->oggStream) && ov_streams(&this->oggStream) == 1)
+			{
+				this->_acquirePageIndex();
+			}
+			this->_seekPcm(0); // make sure the PCM stream is at the beginning to avoid nasty surprises
 		}
 		else
 		{
@@ -102,6 +265,154 @@ namespace xal
 		return this->streamOpen;
 	}
 
+	bool OGG_Source::probe()
+	{
+		// data in memory doesn't have to be read so opening it is cheap
+		if (this->streamOpen || this->memory.data != NULL)
+		{
+			return Source::probe();
+		}
+		if (!hresource::exists(this->filename))
+		{
+			hlog::error(xal::logTag, "Unable to open: " + this->filename);
+			return false;
+		}
+		hresource resource;
+		resource.open(this->filename);
+		// the headers and the first audio page determine the format and the sample at which the audio data starts
+		ogg_sync_state sync;
+		ogg_stream_state oggStream;
+		ogg_page oggPage;
+		ogg_packet packet;
+		vorbis_info info;
+		vorbis_comment comment;
+		ogg_sync_init(&sync);
+		vorbis_info_init(&info);
+		vorbis_comment_init(&comment);
+		bool streamInitialized = false;
+		bool failed = false;
+		unsigned int serial = 0;
+		int headerCount = 0;
+		long lastBlockSize = -1;
+		long blockSize = 0;
+		int64_t accumulated = 0;
+		int64_t startSample = -1;
+		char* buffer = NULL;
+		int read = 0;
+		int result = 0;
+		while (startSample < 0 && !failed)
+		{
+			if (ogg_sync_pageout(&sync, &oggPage) != 1)
+			{
+				buffer = ogg_sync_buffer(&sync, 4096);
+				read = resource.readRaw(buffer, 4096);
+				if (read <= 0)
+				{
+					failed = true;
+					break;
+				}
+				ogg_sync_wrote(&sync, read);
+				continue;
+			}
+			if (!streamInitialized)
+			{
+				serial = (unsigned int)ogg_page_serialno(&oggPage);
+				ogg_stream_init(&oggStream, (int)serial);
+				streamInitialized = true;
+			}
+			if (ogg_stream_pagein(&oggStream, &oggPage) != 0) // pages of other logical streams
+			{
+				continue;
+			}
+			while ((result = ogg_stream_packetout(&oggStream, &packet)) != 0 && !failed)
+			{
+				if (result < 0)
+				{
+					continue;
+				}
+				if (headerCount < 3)
+				{
+					failed = (vorbis_synthesis_headerin(&info, &comment, &packet) != 0);
+					++headerCount;
+					continue;
+				}
+				// same as in vorbisfile, every audio packet after the first one completes the overlap with the previous one
+				blockSize = vorbis_packet_blocksize(&info, &packet);
+				if (blockSize >= 0)
+				{
+					if (lastBlockSize >= 0)
+					{
+						accumulated += (lastBlockSize + blockSize) >> 2;
+					}
+					lastBlockSize = blockSize;
+				}
+			}
+			// streams that were cut out of a longer one don't start at granule position 0
+			if (!failed && lastBlockSize >= 0 && ogg_page_granulepos(&oggPage) != -1)
+			{
+				startSample = hmax((int64_t)ogg_page_granulepos(&oggPage) - accumulated, (int64_t)0);
+			}
+		}
+		int channels = info.channels;
+		int samplingRate = (int)info.rate;
+		if (streamInitialized)
+		{
+			ogg_stream_clear(&oggStream);
+		}
+		vorbis_comment_clear(&comment);
+		vorbis_info_clear(&info);
+		ogg_sync_clear(&sync);
+		if (failed || startSample < 0)
+		{
+			return Source::probe();
+		}
+		// the granule position of the last page is the total number of samples
+		int64_t fileSize = resource.size();
+		int tailSize = (int)hmin(fileSize, (int64_t)OGG_PAGE_MAX_SIZE);
+		unsigned char* tail = new unsigned char[tailSize];
+		resource.seek(fileSize - tailSize, hsbase::START);
+		tailSize = resource.readRaw(tail, tailSize);
+		int64_t samples = -1;
+		unsigned char* page = NULL;
+		int pageSize = 0;
+		uint64_t granule = 0;
+		for (int i = tailSize - OGG_PAGE_HEADER_SIZE; i >= 0 && samples < 0; --i)
+		{
+			page = &tail[i];
+			if (memcmp(page, "OggS", 4) != 0 || ((unsigned int)page[14] | ((unsigned int)page[15] << 8) | ((unsigned int)page[16] << 16) | ((unsigned int)page[17] << 24)) != serial ||
+				i + OGG_PAGE_HEADER_SIZE + page[26] > tailSize)
+			{
+				continue;
+			}
+			pageSize = OGG_PAGE_HEADER_SIZE + page[26];
+			for_iter (j, 0, page[26])
+			{
+				pageSize += page[OGG_PAGE_HEADER_SIZE + j];
+			}
+			granule = 0;
+			for (int j = 7; j >= 0; --j)
+			{
+				granule = (granule << 8) | page[6 + j];
+			}
+			if (i + pageSize <= tailSize && (int64_t)granule != -1)
+			{
+				samples = (int64_t)granule - startSample;
+			}
+		}
+		delete[] tail;
+		// chained streams have a different serial at the end and need to be fully opened
+		if (samples < 0 || channels <= 0 || samplingRate <= 0)
+		{
+			return Source::probe();
+		}
+		this->channels = channels;
+		this->samplingRate = samplingRate;
+		this->bitsPerSample = 16; // always 16 bit data
+		this->size = (int)(samples * this->channels * this->bitsPerSample / 8);
+		this->duration = (float)samples / this->samplingRate;
+		return true;
+	}
+
 	void OGG_Source::close()
 	{
 		if (this->streamOpen)
@@ -115,10 +426,188 @@ namespace xal
 	{
 		if (this->streamOpen)
 		{
-			ov_pcm_seek(&this->oggStream, 0);
+			this->_seekPcm(0);
 		}
 	}
 
+	bool OGG_Source::seek(int64_t samplePosition)
+	{
+		return (this->streamOpen && this->_seekPcm(samplePosition));
+	}
+
+	void OGG_Source::_acquirePageIndex()
+	{
+		hmutex::ScopeLock lock(&OGG_Source::pageIndicesMutex);
+		this->pageIndex = OGG_Source::pageIndices.tryGet(this->filename, NULL);
+		if (this->pageIndex == NULL)
+		{
+			// scanning the whole file takes a while so Sources of other files don't have to wait for it
+			lock.release();
+			PageIndex* index = new PageIndex();
+			index->references = 0;
+			if (!this->_buildPageIndex(index))
+			{
+				hlog::warn(xal::logTag, "OGG: could not build page index: " + this->filename);
+				delete index;
+				return;
+			}
+			lock.acquire(&OGG_Source::pageIndicesMutex);
+			this->pageIndex = OGG_Source::pageIndices.tryGet(this->filename, NULL);
+			if (this->pageIndex == NULL)
+			{
+				hlog::debugf(xal::logTag, "OGG: built page index with %d pages: %s", index->offsets.size(), this->filename.cStr());
+				OGG_Source::pageIndices[this->filename] = index;
+				this->pageIndex = index;
+			}
+			else // another Source of the same file was faster
+			{
+				delete index;
+			}
+		}
+		++this->pageIndex->references;
+	}
+
+	void OGG_Source::_retainSeekIndex()
+	{
+		if (this->pageIndex != NULL)
+		{
+			return;
+		}
+		hmutex::ScopeLock lock(&OGG_Source::pageIndicesMutex);
+		this->pageIndex = OGG_Source::pageIndices.tryGet(this->filename, NULL);
+		if (this->pageIndex != NULL)
+		{
+			++this->pageIndex->references;
+		}
+	}
+
+	void OGG_Source::_releasePageIndex()
+	{
+		if (this->pageIndex == NULL)
+		{
+			return;
+		}
+		hmutex::ScopeLock lock(&OGG_Source::pageIndicesMutex);
+		--this->pageIndex->references;
+		if (this->pageIndex->references <= 0)
+		{
+			OGG_Source::pageIndices.removeKey(this->filename);
+			delete this->pageIndex;
+		}
+		this->pageIndex = NULL;
+	}
+
+	bool OGG_Source::_buildPageIndex(PageIndex* index)
+	{
+		int64_t position = this->_getPosition();
+		this->_seek(0, hsbase::START);
+		unsigned char header[OGG_PAGE_HEADER_SIZE + 255];
+		int64_t offset = 0;
+		int64_t bodySize = 0;
+		uint64_t granule = 0;
+		int segments = 0;
+		bool result = true;
+		// granule positions are stored as PCM positions, relative to the beginning of the logical stream
+		int64_t dataOffset = (int64_t)this->oggStream.dataoffsets[0];
+		int64_t pcmOffset = (int64_t)this->oggStream.pcmlengths[0];
+		while (this->_readRaw(header, OGG_PAGE_HEADER_SIZE) == OGG_PAGE_HEADER_SIZE)
+		{
+			if (memcmp(header, "OggS", 4) != 0)
+			{
+				result = false;
+				break;
+			}
+			segments = header[26];
+			if (this->_readRaw(&header[OGG_PAGE_HEADER_SIZE], segments) != segments)
+			{
+				break;
+			}
+			bodySize = 0;
+			for_iter (i, 0, segments)
+			{
+				bodySize += header[OGG_PAGE_HEADER_SIZE + i];
+			}
+			granule = 0;
+			for (int i = 7; i >= 0; --i)
+			{
+				granule = (granule << 8) | header[6 + i];
+			}
+			// pages without a finished packet have no granule position
+			if (offset >= dataOffset && (int64_t)granule != -1)
+			{
+				index->offsets += offset;
+				index->granules += (int64_t)granule - pcmOffset;
+			}
+			offset += OGG_PAGE_HEADER_SIZE + segments + bodySize;
+			this->_seek(bodySize);
+		}
+		this->_seek(position, hsbase::START);
+		return (result && index->offsets.size() > 0);
+	}
+
+	bool OGG_Source::_seekPcm(int64_t samplePosition)
+	{
+		if (this->pageIndex == NULL)
+		{
+			return (ov_pcm_seek(&this->oggStream, samplePosition) == 0);
+		}
+		// decoding starts at the last page that ends before the sample
+		harray<int64_t>& granules = this->pageIndex->granules;
+		int first = 0;
+		int last = granules.size();
+		int middle = 0;
+		while (first < last)
+		{
+			middle = (first + last) / 2;
+			if (granules[middle] < samplePosition)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+		// the decoder can end up behind the sample if the page's first packet has to be discarded, then one page earlier is tried
+		int64_t offset = 0;
+		int64_t position = -1;
+		for (int page = first - 1; page >= first - 2; --page)
+		{
+			offset = (page >= 0 ? this->pageIndex->offsets[page] : (int64_t)this->oggStream.dataoffsets[0]);
+			if (ov_raw_seek(&this->oggStream, offset) != 0)
+			{
+				break;
+			}
+			position = ov_pcm_tell(&this->oggStream);
+			if (position <= samplePosition || page < 0)
+			{
+				break;
+			}
+		}
+		if (position < 0 || position > samplePosition)
+		{
+			return (ov_pcm_seek(&this->oggStream, samplePosition) == 0);
+		}
+		// discarding decoded data up to the sample
+		char buffer[4096];
+		int remaining = (int)(samplePosition - position) * this->channels * 2;
+		int read = 0;
+		while (remaining > 0)
+		{
+			read = (int)ov_read(&this->oggStream, buffer, hmin(remaining, (int)sizeof(buffer)), 0, 2, 1, &_section);
+			if (read == OV_HOLE)
+			{
+				continue;
+			}
+			if (read <= 0)
+			{
+				return false;
+			}
+			remaining -= read;
+		}
+		return true;
+	}
+
 	bool OGG_Source::load(hstream& output)
 	{
 		if (!Source::load(output))
@@ -128,6 +617,10 @@ namespace xal
 		unsigned long remaining = this->size;
 		output.prepareManualWriteRaw((int)remaining);
 		char* buffer = (char*)output;
+		if (this->_loadParallel(buffer))
+		{
+			return true;
+		}
 		int read = 0;
 		while (remaining > 0)
 		{
@@ -143,6 +636,65 @@ namespace xal
 		return true;
 	}
 
+	bool OGG_Source::_loadParallel(char* output)
+	{
+		if (!xal::manager->isParallelDecoding() || (this->sourceMode != RAM && this->bufferMode != ASYNC && this->memory.data == NULL))
+		{
+			return false;
+		}
+		// chained streams can change the format between links
+		if (ov_streams(&this->oggStream) != 1)
+		{
+			return false;
+		}
+		int count = hmin(BufferAsync::getCpuCount(), (int)(this->duration / PARALLEL_DECODE_MIN_SEGMENT_DURATION));
+		if (count < 2)
+		{
+			return false;
+		}
+		hlog::debugf(xal::logTag, "OGG: decoding in %d segments: %s", count, this->filename.cStr());
+		MemoryView view = this->memory;
+		if (view.data == NULL)
+		{
+			hstream* stream = (hstream*)this->stream; // RAM data is always in an hstream
+			view.data = (unsigned char*)(*stream);
+			view.size = (int64_t)stream->size();
+		}
+		ogg_int64_t total = ov_pcm_total(&this->oggStream, -1);
+		_DecodeSegment* segments = new _DecodeSegment[count];
+		// every load has its own queue and threads so parallel loads don't wait for each other
+		for_iter (i, 0, count)
+		{
+			segments[i].view = view;
+			segments[i].view.position = 0;
+			segments[i].start = total * i / count;
+			segments[i].end = total * (i + 1) / count;
+			segments[i].channels = this->channels;
+			segments[i].output = &output[segments[i].start * this->channels * 2];
+		}
+		_DecodeQueue queue;
+		for_iter (i, 0, count)
+		{
+			queue.segments += &segments[i];
+		}
+		// the current thread works on the queue as well
+		harray<hthread*> threads;
+		for_iter (i, 1, count)
+		{
+			threads += new _DecodeThread(&_decodeQueuedSegmentsThread, &queue);
+			threads.last()->start();
+		}
+		_decodeQueuedSegments(&queue);
+		// all segments are decoded once the threads that took them are finished
+		foreach (hthread*, it, threads)
+		{
+			(*it)->join();
+			delete (*it);
+		}
+		delete[] segments;
+		return true;
+	}
+
 	int OGG_Source::loadChunk(hstream& output, int size)
 	{
 		if (Source::loadChunk(output, size) == 0)
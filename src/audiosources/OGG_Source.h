@@ -16,6 +16,9 @@
 
 #include <vorbis/vorbisfile.h>
 
+#include <hltypes/harray.h>
+#include <hltypes/hmap.h>
+#include <hltypes/hmutex.h>
 #include <hltypes/hstring.h>
 
 #include "AudioManager.h"
@@ -31,13 +34,53 @@ namespace xal
 		~OGG_Source();
 
 		bool open();
+		bool probe();
 		void close();
 		void rewind();
+		bool seek(int64_t samplePosition);
 		bool load(hstream& output);
 		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
 
 	protected:
+		/// @brief Byte offsets and granule positions of the audio pages of a file.
+		struct PageIndex
+		{
+			/// @brief Byte offsets of the pages.
+			harray<int64_t> offsets;
+			/// @brief Granule positions of the pages.
+			harray<int64_t> granules;
+			/// @brief Number of Sources using this index.
+			int references;
+		};
+
 		OggVorbis_File oggStream;
+		/// @brief Page index used for seeking, shared between all Sources of the same file.
+		PageIndex* pageIndex;
+
+		/// @brief Page indices of all currently used files.
+		static hmap<hstr, PageIndex*> pageIndices;
+		/// @brief Mutex for access to the page indices.
+		static hmutex pageIndicesMutex;
+
+		/// @brief Gets the page index of this file or builds it if it doesn't exist yet.
+		void _acquirePageIndex();
+		/// @brief Releases the page index and destroys it if no other Source uses it.
+		void _releasePageIndex();
+		/// @brief Builds a page index by scanning the page headers of the file.
+		/// @param[out] index The index that is filled.
+		/// @return True if the index was built successfully.
+		bool _buildPageIndex(PageIndex* index);
+		void _retainSeekIndex();
+		/// @brief Seeks to a sample by jumping directly to the page that contains it.
+		/// @param[in] samplePosition The sample to seek to.
+		/// @return True if seeking was successful.
+		/// @note Falls back to ov_pcm_seek() if there is no page index.
+		bool _seekPcm(int64_t samplePosition);
+
+		/// @brief Decodes the whole file in multiple segments on multiple threads.
+		/// @param[out] output Memory where all decoded data will be stored.
+		/// @return True if the data was decoded, false if parallel decoding is not possible for this Source.
+		bool _loadParallel(char* output);
 
 	};
 
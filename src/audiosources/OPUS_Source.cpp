@@ -0,0 +1,259 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _FORMAT_OPUS
+#include <stdio.h>
+#include <string.h>
+#include <opusfile.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
+#include <hltypes/hstream.h>
+
+#include "AudioManager.h"
+#include "OPUS_Source.h"
+#include "xal.h"
+
+namespace xal
+{
+	static hsbase::SeekMode _getSeekMode(int whence)
+	{
+		switch (whence)
+		{
+		case SEEK_SET:
+			return hsbase::START;
+		case SEEK_END:
+			return hsbase::END;
+		}
+		return hsbase::CURRENT;
+	}
+
+	static int _dataRead(void* dataSource, unsigned char* data, int size)
+	{
+		return ((hsbase*)dataSource)->readRaw(data, size);
+	}
+
+	static int _dataSeek(void* dataSource, opus_int64 offset, int whence)
+	{
+		((hsbase*)dataSource)->seek((int64_t)offset, _getSeekMode(whence));
+		return 0;
+	}
+
+	static opus_int64 _dataTell(void* dataSource)
+	{
+		return (opus_int64)((hsbase*)dataSource)->position();
+	}
+
+	static int _dataClose(void* dataSource)
+	{
+		return 0;
+	}
+
+	static int _memoryRead(void* dataSource, unsigned char* data, int size)
+	{
+		MemoryView* view = (MemoryView*)dataSource;
+		int read = (int)hmin((int64_t)size, view->size - view->position);
+		if (read <= 0)
+		{
+			return 0;
+		}
+		memcpy(data, &view->data[view->position], read);
+		view->position += read;
+		return read;
+	}
+
+	static int _memorySeek(void* dataSource, opus_int64 offset, int whence)
+	{
+		MemoryView* view = (MemoryView*)dataSource;
+		switch (whence)
+		{
+		case SEEK_CUR:
+			offset += view->position;
+			break;
+		case SEEK_END:
+			offset += view->size;
+			break;
+		}
+		if (offset < 0 || offset > view->size)
+		{
+			return -1;
+		}
+		view->position = (int64_t)offset;
+		return 0;
+	}
+
+	static opus_int64 _memoryTell(void* dataSource)
+	{
+		return (opus_int64)((MemoryView*)dataSource)->position;
+	}
+
+	OPUS_Source::OPUS_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
+	{
+		this->opusFile = NULL;
+		this->downmix = false;
+	}
+
+	OPUS_Source::~OPUS_Source()
+	{
+		this->close();
+	}
+
+	bool OPUS_Source::open()
+	{
+		Source::open();
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		OpusFileCallbacks callbacks;
+		callbacks.read = &_dataRead;
+		callbacks.seek = &_dataSeek;
+		callbacks.tell = &_dataTell;
+		callbacks.close = &_dataClose;
+		void* dataSource = (void*)this->stream;
+		if (this->memory.data != NULL)
+		{
+			callbacks.read = &_memoryRead;
+			callbacks.seek = &_memorySeek;
+			callbacks.tell = &_memoryTell;
+			dataSource = (void*)&this->memory;
+		}
+		int error = 0;
+		this->opusFile = op_open_callbacks(dataSource, &callbacks, NULL, 0, &error);
+		if (this->opusFile != NULL)
+		{
+			this->channels = op_channel_count(this->opusFile, -1);
+			// surround streams are downmixed since audio systems only handle mono and stereo
+			this->downmix = (this->channels > 2);
+			if (this->downmix)
+			{
+				this->channels = 2;
+			}
+			this->samplingRate = OPUS_SAMPLING_RATE;
+			this->bitsPerSample = 16; // always 16 bit data
+			// the total excludes the pre-skip
+			int64_t logicalSamples = (int64_t)op_pcm_total(this->opusFile, -1);
+			if (logicalSamples < 0)
+			{
+				hlog::error(xal::logTag, "OPUS: stream is not seekable: " + this->filename);
+				this->close();
+				return false;
+			}
+			this->size = (int)(logicalSamples * this->channels * this->bitsPerSample / 8);
+			this->duration = (float)((double)logicalSamples / this->samplingRate);
+			const OpusTags* tags = op_tags(this->opusFile, -1);
+			harray<hstr> comments;
+			if (tags != NULL)
+			{
+				for_iter (i, 0, tags->comments)
+				{
+					comments += hstr(tags->user_comments[i], tags->comment_lengths[i]);
+				}
+			}
+			this->_readLoopComments(comments);
+		}
+		else
+		{
+			hlog::error(xal::logTag, hsprintf("OPUS: error %d reading data!", error));
+			this->close();
+		}
+		return this->streamOpen;
+	}
+
+	void OPUS_Source::close()
+	{
+		if (this->opusFile != NULL)
+		{
+			op_free(this->opusFile);
+			this->opusFile = NULL;
+		}
+		Source::close();
+	}
+
+	void OPUS_Source::rewind()
+	{
+		if (this->streamOpen)
+		{
+			this->_seekPcm(0);
+		}
+	}
+
+	bool OPUS_Source::seek(int64_t samplePosition)
+	{
+		return (this->streamOpen && this->_seekPcm(samplePosition));
+	}
+
+	bool OPUS_Source::_seekPcm(int64_t samplePosition)
+	{
+		if (this->opusFile == NULL)
+		{
+			return false;
+		}
+		return (op_pcm_seek(this->opusFile, (opus_int64)samplePosition) == 0);
+	}
+
+	int OPUS_Source::_decode(char* output, int size)
+	{
+		opus_int16* buffer = (opus_int16*)output;
+		int remaining = size / 2;
+		int read = 0;
+		while (remaining >= this->channels)
+		{
+			if (this->downmix)
+			{
+				read = op_read_stereo(this->opusFile, buffer, remaining);
+			}
+			else
+			{
+				read = op_read(this->opusFile, buffer, remaining, NULL);
+			}
+			if (read == OP_HOLE)
+			{
+				continue; // corrupted page, decoding continues with the next one
+			}
+			if (read <= 0)
+			{
+				break;
+			}
+			buffer += read * this->channels;
+			remaining -= read * this->channels;
+		}
+		return (size - remaining * 2);
+	}
+
+	bool OPUS_Source::load(hstream& output)
+	{
+		if (!Source::load(output))
+		{
+			return false;
+		}
+		output.prepareManualWriteRaw(this->size);
+		char* buffer = (char*)output;
+		int written = this->_decode(buffer, this->size);
+		if (written < this->size)
+		{
+			memset(&buffer[written], 0, this->size - written);
+		}
+		return (written > 0);
+	}
+
+	int OPUS_Source::loadChunk(hstream& output, int size)
+	{
+		if (Source::loadChunk(output, size) == 0)
+		{
+			return 0;
+		}
+		output.prepareManualWriteRaw(size);
+		int written = this->_decode((char*)output, size);
+		output.truncate((int64_t)written); // if there wasn't enough data to fill the entire ouput buffer
+		return written;
+	}
+
+}
+#endif
@@ -0,0 +1,64 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Provides a source for Ogg Opus format.
+
+#ifdef _FORMAT_OPUS
+#ifndef XAL_OPUS_SOURCE_H
+#define XAL_OPUS_SOURCE_H
+
+#include <opusfile.h>
+
+#include <hltypes/hstring.h>
+
+#include "AudioManager.h"
+#include "Source.h"
+#include "xalExport.h"
+
+// Opus is always decoded at this sampling rate, conversion is done by the audio system
+#define OPUS_SAMPLING_RATE 48000
+
+namespace xal
+{
+	class xalExport OPUS_Source : public Source
+	{
+	public:
+		OPUS_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode);
+		~OPUS_Source();
+
+		bool open();
+		void close();
+		void rewind();
+		bool seek(int64_t samplePosition);
+		bool load(hstream& output);
+		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+
+	protected:
+		OggOpusFile* opusFile;
+		/// @brief Whether more than 2 channels are downmixed to stereo.
+		bool downmix;
+
+		/// @brief Seeks to a sample.
+		/// @param[in] samplePosition The sample to seek to.
+		/// @return True if seeking was successful.
+		/// @note The pre-skip and the pre-roll needed after seeking are handled by opusfile.
+		bool _seekPcm(int64_t samplePosition);
+		/// @brief Decodes data into 16 bit PCM.
+		/// @param[in] output Output buffer.
+		/// @param[in] size Size of the output buffer in bytes.
+		/// @return Number of bytes written.
+		int _decode(char* output, int size);
+
+	};
+
+}
+
+#endif
+#endif
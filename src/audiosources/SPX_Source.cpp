@@ -7,20 +7,41 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _FORMAT_SPX
-#include <speex/speex.h>
+#include <string.h>
 
+#include <speex/speex_callbacks.h>
+#include <speex/speex_header.h>
+
+#include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hsbase.h>
 #include <hltypes/hstring.h>
 
 #include "SPX_Source.h"
 #include "xal.h"
 
-#define FRAME_SIZE 640
+#define SPX_READ_SIZE 4096
+#define SPX_TAIL_SIZE 65307 // maximum size of an Ogg page
 
 namespace xal
 {
 	SPX_Source::SPX_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
 	{
+		this->decoderState = NULL;
+		this->stereoState = NULL;
+		this->serialNumber = 0;
+		this->mode = 0;
+		this->frameSize = 0;
+		this->framesPerPacket = 1;
+		this->headerPackets = 2;
+		this->totalSamples = 0;
+		this->headerPacketsRemaining = 0;
+		this->samplesRemaining = 0;
+		this->skipSamples = 0;
+		this->skipCalculated = false;
+		this->packetSamples = NULL;
+		this->blockFrames = 0;
+		this->blockPosition = 0;
 	}
 
 	SPX_Source::~SPX_Source()
@@ -28,68 +49,307 @@ namespace xal
 		this->close();
 	}
 
-	bool SPX_Source::load(hstream& output)
+	bool SPX_Source::open()
 	{
-		if (!Source::load(output))
+		Source::open();
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		if (!this->_readMetaData())
 		{
+			this->close();
 			return false;
 		}
-		/*
-		float output2[FRAME_SIZE];
-		char cbits[200];
-		unsigned short nbBytes;
-		void* state;
-		SpeexBits bits;
-		int i, tmp;
-		state = speex_decoder_init(&speex_uwb_mode);
-		tmp = 1;
-		speex_decoder_ctl(state, SPEEX_SET_ENH, &tmp);
-
-		int size;
-		unsigned char* stream = output;
-
-		//fin = fopen(this->fileName.cStr(), "rb");
-		int offset = 0;
-		memcpy(&size, &output[offset], sizeof(int));
-		offset += sizeof(int);
-		short* buffer = (short*)malloc((FRAME_SIZE + size) * 2 * sizeof(short));
-		short* bufferPtr = buffer;
-
-		speex_bits_init(&bits);
-		int nFrames = 0;
-		while (true)
-		{
-			memcpy(&nbBytes, &output[offset], sizeof(unsigned short));
-			offset += sizeof(unsigned short);
-			//fread(&nbBytes, sizeof(unsigned short), 1, fin);
-			//  fprintf (stderr, "nbBytes: %d\n", nbBytes);
-			if (offset >= this->size)
+		this->decoderState = speex_decoder_init(speex_lib_get_mode(this->mode));
+		int value = 1;
+		speex_decoder_ctl(this->decoderState, SPEEX_SET_ENH, &value);
+		value = this->samplingRate;
+		speex_decoder_ctl(this->decoderState, SPEEX_SET_SAMPLING_RATE, &value);
+		speex_decoder_ctl(this->decoderState, SPEEX_GET_FRAME_SIZE, &this->frameSize);
+		if (this->channels == 2)
+		{
+			// stereo is stored in-band as side information of a mono stream
+			this->stereoState = speex_stereo_state_init();
+			SpeexCallback callback;
+			callback.callback_id = SPEEX_INBAND_STEREO;
+			callback.func = &speex_std_stereo_request_handler;
+			callback.data = this->stereoState;
+			speex_decoder_ctl(this->decoderState, SPEEX_SET_HANDLER, &callback);
+		}
+		speex_bits_init(&this->bits);
+		ogg_sync_init(&this->oggSyncState);
+		ogg_stream_init(&this->oggStreamState, this->serialNumber);
+		this->packetSamples = new short[this->frameSize * this->channels * this->framesPerPacket];
+		this->rewind();
+		return this->streamOpen;
+	}
+
+	void SPX_Source::close()
+	{
+		if (this->decoderState != NULL)
+		{
+			speex_decoder_destroy(this->decoderState);
+			this->decoderState = NULL;
+			speex_bits_destroy(&this->bits);
+			ogg_stream_clear(&this->oggStreamState);
+			ogg_sync_clear(&this->oggSyncState);
+		}
+		if (this->stereoState != NULL)
+		{
+			speex_stereo_state_destroy(this->stereoState);
+			this->stereoState = NULL;
+		}
+		if (this->packetSamples != NULL)
+		{
+			delete [] this->packetSamples;
+			this->packetSamples = NULL;
+		}
+		Source::close();
+	}
+
+	bool SPX_Source::_readMetaData()
+	{
+		// data will be reloaded, clearing it here
+		this->channels = 0;
+		this->samplingRate = 0;
+		this->bitsPerSample = 0;
+		this->size = 0;
+		this->duration = 0.0f;
+		this->totalSamples = 0;
+		ogg_sync_state syncState;
+		ogg_stream_state streamState;
+		ogg_page page;
+		ogg_packet packet;
+		char* buffer = NULL;
+		int read = 0;
+		ogg_sync_init(&syncState);
+		// the header packet is always alone in the first page
+		while (ogg_sync_pageout(&syncState, &page) != 1)
+		{
+			buffer = ogg_sync_buffer(&syncState, SPX_READ_SIZE);
+			read = this->_readRaw(buffer, SPX_READ_SIZE);
+			if (read <= 0)
 			{
-				break;
+				ogg_sync_clear(&syncState);
+				return false;
 			}
+			ogg_sync_wrote(&syncState, read);
+		}
+		this->serialNumber = ogg_page_serialno(&page);
+		ogg_stream_init(&streamState, this->serialNumber);
+		SpeexHeader* header = NULL;
+		if (ogg_stream_pagein(&streamState, &page) == 0 && ogg_stream_packetout(&streamState, &packet) == 1)
+		{
+			header = speex_packet_to_header((char*)packet.packet, (int)packet.bytes);
+		}
+		ogg_stream_clear(&streamState);
+		bool result = false;
+		if (header != NULL)
+		{
+			if (header->mode >= 0 && header->mode < SPEEX_NB_MODES && header->nb_channels >= 1 && header->nb_channels <= 2 && header->rate > 0)
+			{
+				this->mode = header->mode;
+				this->channels = header->nb_channels;
+				this->samplingRate = header->rate;
+				this->framesPerPacket = hmax(header->frames_per_packet, 1);
+				this->headerPackets = 2 + hmax(header->extra_headers, 0); // header, comments and extra headers
+				result = true;
+			}
+			speex_header_free(header);
+		}
+		if (result)
+		{
+			// the granule position of the last page is the total number of samples
+			ogg_sync_reset(&syncState);
+			this->_seek(0, hsbase::END);
+			int64_t fileSize = this->_getPosition();
+			this->_seek(hmax(fileSize - SPX_TAIL_SIZE, (int64_t)0), hsbase::START);
+			int pageResult = 0;
+			while (true)
+			{
+				buffer = ogg_sync_buffer(&syncState, SPX_READ_SIZE);
+				read = this->_readRaw(buffer, SPX_READ_SIZE);
+				if (read <= 0)
+				{
+					break;
+				}
+				ogg_sync_wrote(&syncState, read);
+				while ((pageResult = ogg_sync_pageout(&syncState, &page)) != 0)
+				{
+					if (pageResult == 1 && ogg_page_serialno(&page) == this->serialNumber && ogg_page_granulepos(&page) > 0)
+					{
+						this->totalSamples = ogg_page_granulepos(&page);
+					}
+				}
+			}
+			if (this->totalSamples <= 0)
+			{
+				hlog::warn(xal::logTag, "Speex stream without length is not supported: " + this->filename);
+				result = false;
+			}
+		}
+		ogg_sync_clear(&syncState);
+		this->_seek(0, hsbase::START);
+		if (!result)
+		{
+			return false;
+		}
+		this->bitsPerSample = 16;
+		this->size = (int)(this->totalSamples * this->channels * 2);
+		this->duration = (float)((double)this->totalSamples / this->samplingRate);
+		return true;
+	}
+
+	void SPX_Source::rewind()
+	{
+		if (this->streamOpen)
+		{
+			this->_seek(0, hsbase::START);
+			ogg_sync_reset(&this->oggSyncState);
+			ogg_stream_reset(&this->oggStreamState);
+			speex_decoder_ctl(this->decoderState, SPEEX_RESET_STATE, NULL);
+			this->headerPacketsRemaining = this->headerPackets;
+			this->samplesRemaining = this->totalSamples;
+			this->skipSamples = 0;
+			this->skipCalculated = false;
+			this->blockFrames = 0;
+			this->blockPosition = 0;
+		}
+	}
 
-			memcpy(cbits, &output[offset], nbBytes);
-			offset += nbBytes;
-			speex_bits_read_from(&bits, cbits, nbBytes);
+	bool SPX_Source::_readPacket(ogg_packet* packet)
+	{
+		ogg_page page;
+		char* buffer = NULL;
+		int read = 0;
+		while (ogg_stream_packetout(&this->oggStreamState, packet) != 1)
+		{
+			while (ogg_sync_pageout(&this->oggSyncState, &page) != 1)
+			{
+				buffer = ogg_sync_buffer(&this->oggSyncState, SPX_READ_SIZE);
+				read = this->_readRaw(buffer, SPX_READ_SIZE);
+				if (read <= 0)
+				{
+					return false;
+				}
+				ogg_sync_wrote(&this->oggSyncState, read);
+			}
+			// pages of other logical streams are ignored
+			if (ogg_page_serialno(&page) != this->serialNumber)
+			{
+				continue;
+			}
+			ogg_stream_pagein(&this->oggStreamState, &page);
+			// the first audio page determines how many samples at the beginning are encoder delay
+			if (!this->skipCalculated && ogg_page_granulepos(&page) > 0)
+			{
+				this->skipSamples = (int)hmax((int64_t)ogg_page_packets(&page) * this->framesPerPacket * this->frameSize - (int64_t)ogg_page_granulepos(&page), (int64_t)0);
+				this->skipCalculated = true;
+			}
+		}
+		return true;
+	}
 
-			speex_decode(state, &bits, output2);
+	bool SPX_Source::_decodeNextPacket()
+	{
+		ogg_packet packet;
+		short* output = NULL;
+		int frames = 0;
+		int skipped = 0;
+		while (this->samplesRemaining > 0)
+		{
+			if (!this->_readPacket(&packet))
+			{
+				return false;
+			}
+			if (this->headerPacketsRemaining > 0)
+			{
+				--this->headerPacketsRemaining;
+				continue;
+			}
+			speex_bits_read_from(&this->bits, (char*)packet.packet, (int)packet.bytes);
+			output = this->packetSamples;
+			frames = 0;
+			for_iter (i, 0, this->framesPerPacket)
+			{
+				if (speex_decode_int(this->decoderState, &this->bits, output) != 0 || speex_bits_remaining(&this->bits) < 0)
+				{
+					break;
+				}
+				if (this->stereoState != NULL)
+				{
+					speex_decode_stereo_int(output, this->frameSize, this->stereoState);
+				}
+				output += this->frameSize * this->channels;
+				++frames;
+			}
+			this->blockFrames = frames * this->frameSize;
+			this->blockPosition = 0;
+			if (this->skipSamples > 0)
+			{
+				skipped = hmin(this->skipSamples, this->blockFrames);
+				this->blockPosition = skipped;
+				this->skipSamples -= skipped;
+			}
+			if (this->blockFrames - this->blockPosition > this->samplesRemaining)
+			{
+				this->blockFrames = this->blockPosition + (int)this->samplesRemaining;
+			}
+			this->samplesRemaining -= this->blockFrames - this->blockPosition;
+			if (this->blockFrames > this->blockPosition)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
 
-			for_iterx (i, 0, FRAME_SIZE)
+	int SPX_Source::_decode(char* output, int size)
+	{
+		int frameSize = this->channels * 2;
+		int written = 0;
+		int count = 0;
+		while (written + frameSize <= size)
+		{
+			if (this->blockPosition >= this->blockFrames && !this->_decodeNextPacket())
 			{
-				bufferPtr[i] = (short)output2[i];
+				break;
 			}
-			++nFrames;
+			count = hmin(this->blockFrames - this->blockPosition, (size - written) / frameSize);
+			memcpy(&output[written], &this->packetSamples[this->blockPosition * this->channels], count * frameSize);
+			this->blockPosition += count;
+			written += count * frameSize;
 		}
+		return written;
+	}
 
-		//printf("read %d speex frames\n",nFrames);
-		speex_decoder_destroy(state);
-		speex_bits_destroy(&bits);
-		//alBufferData(this->buffer, AL_FORMAT_MONO16, buffer, size * 2, 44100);
-		this->duration = (float)size / 44100;
-		free(buffer);
-		// REFACTOR TO HERE
-		//*/
-		return true;
+	bool SPX_Source::load(hstream& output)
+	{
+		if (!Source::load(output))
+		{
+			return false;
+		}
+		output.prepareManualWriteRaw(this->size);
+		char* buffer = (char*)output;
+		int written = this->_decode(buffer, this->size);
+		if (written < this->size)
+		{
+			memset(&buffer[written], 0, this->size - written);
+		}
+		return (written > 0);
+	}
+
+	int SPX_Source::loadChunk(hstream& output, int size)
+	{
+		if (Source::loadChunk(output, size) == 0)
+		{
+			return 0;
+		}
+		output.prepareManualWriteRaw(size);
+		int written = this->_decode((char*)output, size);
+		output.truncate((int64_t)written); // if there wasn't enough data to fill the entire ouput buffer
+		return written;
 	}
 
 }
@@ -8,14 +8,19 @@
 /// 
 /// @section DESCRIPTION
 /// 
-/// Provides a source for OGG format.
+/// Provides a source for Speex format.
 
 #ifdef _FORMAT_SPX
 #ifndef XAL_SPX_SOURCE_H
 #define XAL_SPX_SOURCE_H
 
+#include <ogg/ogg.h>
+#include <speex/speex.h>
+#include <speex/speex_stereo.h>
+
 #include <hltypes/hstring.h>
 
+#include "AudioManager.h"
 #include "Source.h"
 #include "xalExport.h"
 
@@ -27,7 +32,62 @@ namespace xal
 		SPX_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode);
 		~SPX_Source();
 
+		bool open();
+		void close();
+		void rewind();
 		bool load(hstream& output);
+		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+
+	protected:
+		ogg_sync_state oggSyncState;
+		ogg_stream_state oggStreamState;
+		SpeexBits bits;
+		/// @brief Speex decoder.
+		void* decoderState;
+		/// @brief In-band stereo state.
+		SpeexStereoState* stereoState;
+		/// @brief Serial number of the Speex stream.
+		int serialNumber;
+		/// @brief Speex mode index from the header.
+		int mode;
+		/// @brief Number of samples in one Speex frame.
+		int frameSize;
+		/// @brief Number of Speex frames in one Ogg packet.
+		int framesPerPacket;
+		/// @brief Number of header packets that precede the audio packets.
+		int headerPackets;
+		/// @brief Total number of samples per channel.
+		int64_t totalSamples;
+		/// @brief Number of header packets that still have to be skipped.
+		int headerPacketsRemaining;
+		/// @brief Number of samples that still have to be output.
+		int64_t samplesRemaining;
+		/// @brief Number of samples at the beginning that are encoder delay.
+		int skipSamples;
+		/// @brief Whether the encoder delay was determined from the first audio page.
+		bool skipCalculated;
+		/// @brief Decoded samples of the current packet.
+		short* packetSamples;
+		/// @brief Number of sample frames in the current packet.
+		int blockFrames;
+		/// @brief Number of sample frames already consumed from the current packet.
+		int blockPosition;
+
+		/// @brief Reads the Speex header and determines the length from the last page.
+		/// @return True if the data is in a supported format.
+		bool _readMetaData();
+		/// @brief Reads the next packet of the Speex stream.
+		/// @param[out] packet The packet.
+		/// @return True if a packet was read.
+		bool _readPacket(ogg_packet* packet);
+		/// @brief Decodes the next audio packet.
+		/// @return True if any samples were decoded.
+		bool _decodeNextPacket();
+		/// @brief Decodes data into 16 bit PCM.
+		/// @param[in] output Output buffer.
+		/// @param[in] size Size of the output buffer in bytes.
+		/// @return Number of bytes written.
+		int _decode(char* output, int size);
 
 	};
 
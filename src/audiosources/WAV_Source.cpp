@@ -9,7 +9,10 @@
 #ifdef _FORMAT_WAV
 #include <string.h>
 
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hresource.h>
+#include <hltypes/hsbase.h>
 
 #include "AudioManager.h"
 #include "WAV_Source.h"
@@ -17,8 +20,169 @@
 
 namespace xal
 {
+	static int imaStepTable[89] =
+	{
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+		50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+		337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+		2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+		15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+	static int imaIndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+	static int msAdaptationTable[16] = {230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230};
+	static short msDefaultCoefficients[14] = {256, 0, 512, -256, 0, 0, 192, 64, 240, 0, 460, -208, 392, -232};
+
+	static inline short _readShort(const unsigned char* data)
+	{
+		return (short)(data[0] | (data[1] << 8));
+	}
+
+	static inline short _decodeImaNibble(int nibble, int& predictor, int& index)
+	{
+		int step = imaStepTable[index];
+		int difference = step >> 3;
+		if ((nibble & 1) != 0)
+		{
+			difference += step >> 2;
+		}
+		if ((nibble & 2) != 0)
+		{
+			difference += step >> 1;
+		}
+		if ((nibble & 4) != 0)
+		{
+			difference += step;
+		}
+		predictor = hclamp((nibble & 8) != 0 ? predictor - difference : predictor + difference, -32768, 32767);
+		index = hclamp(index + imaIndexTable[nibble], 0, 88);
+		return (short)predictor;
+	}
+
+	/// @note Every channel has a 4 byte header, followed by interleaved groups of 4 bytes per channel with 8 samples each.
+	static int _decodeImaBlock(const unsigned char* data, int size, int channels, short* output)
+	{
+		int headerSize = 4 * channels;
+		if (size < headerSize)
+		{
+			return 0;
+		}
+		int predictors[WAV_ADPCM_MAX_CHANNELS];
+		int indices[WAV_ADPCM_MAX_CHANNELS];
+		for_iter (i, 0, channels)
+		{
+			predictors[i] = _readShort(&data[i * 4]);
+			indices[i] = hclamp((int)data[i * 4 + 2], 0, 88);
+			output[i] = (short)predictors[i];
+		}
+		int groups = (size - headerSize) / headerSize;
+		data += headerSize;
+		short* samples = NULL;
+		for_iter (i, 0, groups)
+		{
+			for_iter (j, 0, channels)
+			{
+				samples = &output[(1 + i * 8) * channels + j];
+				for_iter (k, 0, 4)
+				{
+					samples[0] = _decodeImaNibble(*data & 0xF, predictors[j], indices[j]);
+					samples[channels] = _decodeImaNibble(*data >> 4, predictors[j], indices[j]);
+					samples += channels * 2;
+					++data;
+				}
+			}
+		}
+		return (1 + groups * 8);
+	}
+
+	static inline short _decodeMsNibble(int nibble, int& sample1, int& sample2, int& delta, const short* coefficients)
+	{
+		int predictor = (sample1 * coefficients[0] + sample2 * coefficients[1]) >> 8;
+		predictor = hclamp(predictor + (nibble >= 8 ? nibble - 16 : nibble) * delta, -32768, 32767);
+		sample2 = sample1;
+		sample1 = predictor;
+		delta = hmax((msAdaptationTable[nibble] * delta) >> 8, 16);
+		return (short)predictor;
+	}
+
+	/// @note The header contains the predictor index, delta and the first two samples for each channel, stored in that order and interleaved.
+	static int _decodeMsBlock(const unsigned char* data, int size, int channels, const harray<short>& coefficients, short* output)
+	{
+		int headerSize = 7 * channels;
+		if (size < headerSize)
+		{
+			return 0;
+		}
+		const short* blockCoefficients[WAV_ADPCM_MAX_CHANNELS];
+		int deltas[WAV_ADPCM_MAX_CHANNELS];
+		int samples1[WAV_ADPCM_MAX_CHANNELS];
+		int samples2[WAV_ADPCM_MAX_CHANNELS];
+		for_iter (i, 0, channels)
+		{
+			if (data[i] * 2 >= coefficients.size())
+			{
+				return 0;
+			}
+			blockCoefficients[i] = &coefficients[data[i] * 2];
+			deltas[i] = _readShort(&data[channels + i * 2]);
+			samples1[i] = _readShort(&data[channels * 3 + i * 2]);
+			samples2[i] = _readShort(&data[channels * 5 + i * 2]);
+			output[i] = (short)samples2[i];
+			output[channels + i] = (short)samples1[i];
+		}
+		int count = (2 + (size - headerSize) * 2 / channels) * channels;
+		data += headerSize;
+		// high nibble first, stereo alternates between left and right with every nibble
+		int channel = 0;
+		for (int i = channels * 2; i < count; i += 2)
+		{
+			output[i] = _decodeMsNibble(*data >> 4, samples1[channel], samples2[channel], deltas[channel], blockCoefficients[channel]);
+			channel = (channel + 1) % channels;
+			output[i + 1] = _decodeMsNibble(*data & 0xF, samples1[channel], samples2[channel], deltas[channel], blockCoefficients[channel]);
+			channel = (channel + 1) % channels;
+			++data;
+		}
+		return (count / channels);
+	}
+
+	static void _convertPcm24(const unsigned char* input, short* output, int count)
+	{
+		for_iter (i, 0, count)
+		{
+			output[i] = (short)(input[i * 3 + 1] | (input[i * 3 + 2] << 8));
+		}
+	}
+
+	static void _convertPcm32(const int* input, short* output, int count)
+	{
+		for_iter (i, 0, count)
+		{
+			output[i] = (short)(input[i] >> 16);
+		}
+	}
+
+	static void _convertFloat32(const float* input, short* output, int count)
+	{
+		float value = 0.0f;
+		for_iter (i, 0, count)
+		{
+			value = input[i] * 32767.0f;
+			output[i] = (short)(value < -32768.0f ? -32768.0f : (value > 32767.0f ? 32767.0f : value));
+		}
+	}
+
 	WAV_Source::WAV_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
 	{
+		this->formatTag = WAV_FORMAT_PCM;
+		this->sampleSize = 0;
+		this->blockAlign = 0;
+		this->dataOffset = 0;
+		this->dataSize = 0;
+		this->blockData = NULL;
+		this->blockSamples = NULL;
+		this->blockFrames = 0;
+		this->blockPosition = 0;
+		this->dataRemaining = 0;
+		this->framesRemaining = 0;
 	}
 
 	WAV_Source::~WAV_Source()
@@ -33,71 +197,258 @@ namespace xal
 		{
 			return false;
 		}
+		if (!this->_readMetaData())
+		{
+			this->close();
+			return false;
+		}
+		if (this->_isAdpcm())
+		{
+			this->blockData = new unsigned char[this->blockAlign];
+			this->blockSamples = new short[this->_getBlockFrames(this->blockAlign) * this->channels];
+		}
+		else if (!this->_isNative())
+		{
+			this->blockData = new unsigned char[WAV_CONVERSION_BUFFER_SIZE];
+		}
+		this->_findData();
+		return this->streamOpen;
+	}
+
+	void WAV_Source::close()
+	{
+		if (this->blockData != NULL)
+		{
+			delete [] this->blockData;
+			this->blockData = NULL;
+		}
+		if (this->blockSamples != NULL)
+		{
+			delete [] this->blockSamples;
+			this->blockSamples = NULL;
+		}
+		Source::close();
+	}
+
+	bool WAV_Source::_readMetaData()
+	{
 		// data will be reloaded, clearing it here
 		this->channels = 0;
 		this->samplingRate = 0;
 		this->bitsPerSample = 0;
 		this->size = 0;
 		this->duration = 0.0f;
+		this->formatTag = WAV_FORMAT_PCM;
+		this->sampleSize = 0;
+		this->blockAlign = 0;
+		this->dataOffset = 0;
+		this->dataSize = 0;
+		this->loopStart = 0;
+		this->loopEnd = 0;
+		this->coefficients.clear();
 		// data loading
-		unsigned char buffer[5] = {0};
-		this->stream->readRaw(buffer, 4); // RIFF
-		this->stream->readRaw(buffer, 4); // file size
-		this->stream->readRaw(buffer, 4); // WAVE
+		unsigned char buffer[17] = {0};
+		this->_readRaw(buffer, 4); // RIFF
+		this->_readRaw(buffer, 4); // file size
+		this->_readRaw(buffer, 4); // WAVE
 		hstr tag;
 		int size = 0;
+		int padding = 0;
 		short value16;
 		int value32;
-		while (!this->stream->eof())
+		int factFrames = -1;
+		bool dataFound = false;
+		// all chunks are parsed in a single pass, the data chunk is only remembered and skipped
+		while (!this->_isEof())
 		{
-			this->stream->readRaw(buffer, 4); // next tag
-			tag = (char*)buffer;
-			this->stream->readRaw(buffer, 4); // size of the chunk
+			if (this->_readRaw(buffer, 4) < 4) // next tag
+			{
+				break;
+			}
+			tag = hstr((char*)buffer, 4);
+			this->_readRaw(buffer, 4); // size of the chunk
 			memcpy(&size, buffer, 4);
+			padding = (size & 1); // chunks are aligned to 2 bytes
 			if (tag == "fmt ")
 			{
+				if (size < 16)
+				{
+					return false;
+				}
 				// format
-				this->stream->readRaw(buffer, 2);
+				this->_readRaw(buffer, 2);
+				memcpy(&value16, buffer, 2);
+				this->formatTag = (unsigned short)value16;
+				// channels
+				this->_readRaw(buffer, 2);
+				memcpy(&value16, buffer, 2);
+				this->channels = value16;
+				// sampling rate
+				this->_readRaw(buffer, 4);
+				memcpy(&value32, buffer, 4);
+				this->samplingRate = value32;
+				// bytes rate
+				this->_readRaw(buffer, 4);
+				// blockalign
+				this->_readRaw(buffer, 2);
+				memcpy(&value16, buffer, 2);
+				this->blockAlign = (unsigned short)value16;
+				// bits per sample
+				this->_readRaw(buffer, 2);
 				memcpy(&value16, buffer, 2);
-				if (size == 16 && value16 == 1)
+				this->bitsPerSample = value16;
+				size -= 16;
+				if (this->formatTag == WAV_FORMAT_EXTENSIBLE)
 				{
-					// channels
-					this->stream->readRaw(buffer, 2);
-					memcpy(&value16, buffer, 2);
-					this->channels = value16;
-					// sampling rate
-					this->stream->readRaw(buffer, 4);
-					memcpy(&value32, buffer, 4);
-					this->samplingRate = value32;
-					// bytes rate
-					this->stream->readRaw(buffer, 4);
-					// blockalign
-					this->stream->readRaw(buffer, 2);
-					// bits per sample
-					this->stream->readRaw(buffer, 2);
-					memcpy(&value16, buffer, 2);
-					this->bitsPerSample = value16;
-					size = 0;
+					if (size < 24)
+					{
+						return false;
+					}
+					// extra size, valid bits and channel mask are skipped, the sub-format GUID starts with the actual format tag
+					this->_readRaw(buffer, 8);
+					this->_readRaw(buffer, 16);
+					this->formatTag = (unsigned short)_readShort(buffer);
+					size -= 24;
 				}
-				else // not PCM, some form of compressed format
+				if (this->formatTag == WAV_FORMAT_PCM || this->formatTag == WAV_FORMAT_IEEE_FLOAT)
 				{
-					size -= 2;
-					this->close();
-					break;
+					this->sampleSize = this->bitsPerSample / 8;
+					if (this->bitsPerSample % 8 != 0 || (this->formatTag == WAV_FORMAT_PCM && (this->sampleSize < 1 || this->sampleSize > 4)) ||
+						(this->formatTag == WAV_FORMAT_IEEE_FLOAT && this->sampleSize != 4))
+					{
+						hlog::warn(xal::logTag, hsprintf("Unsupported WAV sample size of %d bits: %s", this->bitsPerSample, this->filename.cStr()));
+						return false;
+					}
+					// everything above 16 bit is converted to 16 bit
+					if (this->sampleSize > 2)
+					{
+						this->bitsPerSample = 16;
+					}
+				}
+				else if (this->formatTag == WAV_FORMAT_MS_ADPCM || this->formatTag == WAV_FORMAT_IMA_ADPCM)
+				{
+					// ADPCM is decoded to 16 bit PCM
+					if (this->bitsPerSample != 4 || this->channels < 1 || this->channels > WAV_ADPCM_MAX_CHANNELS || this->_getBlockFrames(this->blockAlign) <= 0)
+					{
+						hlog::warn(xal::logTag, "Unsupported ADPCM layout: " + this->filename);
+						return false;
+					}
+					this->bitsPerSample = 16;
+					if (this->formatTag == WAV_FORMAT_MS_ADPCM)
+					{
+						// extra size and samples per block are skipped, the latter is always derived from the block alignment
+						if (size >= 6)
+						{
+							this->_readRaw(buffer, 4);
+							this->_readRaw(buffer, 2);
+							memcpy(&value16, buffer, 2);
+							size -= 6;
+							for_iter (i, 0, value16)
+							{
+								if (size < 4)
+								{
+									break;
+								}
+								this->_readRaw(buffer, 4);
+								this->coefficients += _readShort(buffer);
+								this->coefficients += _readShort(&buffer[2]);
+								size -= 4;
+							}
+						}
+						if (this->coefficients.size() == 0)
+						{
+							this->coefficients = harray<short>(msDefaultCoefficients, 14);
+						}
+					}
+				}
+				else
+				{
+					hlog::warn(xal::logTag, hsprintf("Unsupported WAV format tag 0x%X: %s", this->formatTag, this->filename.cStr()));
+					return false;
 				}
 			}
-			else if (tag == "data")
+			else if (tag == "fact" && size >= 4)
 			{
-				this->size += size;
+				this->_readRaw(buffer, 4);
+				memcpy(&factFrames, buffer, 4);
+				size -= 4;
 			}
-			if (size > 0)
+			else if (tag == "smpl" && size >= 60)
 			{
-				this->stream->seek(size);
+				// only the first loop is used, the sampler fields in front of the loop count are skipped
+				this->_seek(28);
+				this->_readRaw(buffer, 4);
+				memcpy(&value32, buffer, 4);
+				this->_seek(4);
+				size -= 36;
+				if (value32 > 0)
+				{
+					// cue point ID and loop type are skipped, the end sample is still part of the loop
+					this->_seek(8);
+					this->_readRaw(buffer, 8);
+					memcpy(&value32, buffer, 4);
+					this->loopStart = hmax(value32, 0);
+					memcpy(&value32, &buffer[4], 4);
+					this->loopEnd = hmax(value32, 0) + 1;
+					size -= 16;
+				}
+			}
+			else if (tag == "data" && !dataFound)
+			{
+				dataFound = true;
+				this->dataOffset = this->_getPosition();
+				this->dataSize = size;
+			}
+			if (size + padding > 0)
+			{
+				this->_seek(size + padding);
 			}
 		}
-		this->duration = (float)this->size / (this->samplingRate * this->channels * this->bitsPerSample / 8);
-		this->_findData();
-		return this->streamOpen;
+		if (!dataFound || this->channels == 0 || this->samplingRate == 0 || this->bitsPerSample == 0)
+		{
+			return false;
+		}
+		int frames = 0;
+		if (this->_isAdpcm())
+		{
+			frames = this->dataSize / this->blockAlign * this->_getBlockFrames(this->blockAlign) + this->_getBlockFrames(this->dataSize % this->blockAlign);
+			if (factFrames >= 0)
+			{
+				frames = hmin(frames, factFrames);
+			}
+		}
+		else
+		{
+			frames = this->dataSize / (this->channels * this->sampleSize);
+		}
+		this->size = frames * this->channels * this->bitsPerSample / 8;
+		this->duration = (float)frames / this->samplingRate;
+		return true;
+	}
+
+	bool WAV_Source::_isAdpcm()
+	{
+		return (this->formatTag == WAV_FORMAT_MS_ADPCM || this->formatTag == WAV_FORMAT_IMA_ADPCM);
+	}
+
+	bool WAV_Source::_isNative()
+	{
+		return (this->formatTag == WAV_FORMAT_PCM && this->sampleSize <= 2);
+	}
+
+	int WAV_Source::_getBlockFrames(int blockSize)
+	{
+		if (this->formatTag == WAV_FORMAT_IMA_ADPCM)
+		{
+			int headerSize = 4 * this->channels;
+			return (blockSize >= headerSize ? 1 + (blockSize - headerSize) / headerSize * 8 : 0);
+		}
+		if (this->formatTag == WAV_FORMAT_MS_ADPCM)
+		{
+			int headerSize = 7 * this->channels;
+			return (blockSize >= headerSize ? 2 + (blockSize - headerSize) * 2 / this->channels : 0);
+		}
+		return 0;
 	}
 
 	void WAV_Source::rewind()
@@ -108,30 +459,130 @@ namespace xal
 		}
 	}
 
+	bool WAV_Source::seek(int64_t samplePosition)
+	{
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		this->_findData();
+		if (!this->_isAdpcm())
+		{
+			int frameSize = this->channels * this->sampleSize;
+			int offset = (int)hmin(samplePosition * frameSize, (int64_t)(this->dataSize / frameSize * frameSize));
+			this->_seek(offset);
+			this->dataRemaining -= offset;
+			return true;
+		}
+		// ADPCM blocks are decoded independently so whole blocks can be skipped
+		int blockFrames = this->_getBlockFrames(this->blockAlign);
+		if (blockFrames <= 0)
+		{
+			return false;
+		}
+		int blocks = (int)hmin(samplePosition / blockFrames, (int64_t)(this->dataSize / this->blockAlign));
+		this->_seek((int64_t)blocks * this->blockAlign);
+		this->dataRemaining -= blocks * this->blockAlign;
+		this->framesRemaining = hmax(this->framesRemaining - blocks * blockFrames, 0);
+		samplePosition -= (int64_t)blocks * blockFrames;
+		if (samplePosition > 0 && this->_decodeBlock())
+		{
+			this->blockPosition = (int)hmin(samplePosition, (int64_t)this->blockFrames);
+		}
+		return true;
+	}
+
 	void WAV_Source::_findData()
 	{
-		this->stream->rewind();
-		unsigned char buffer[5] = {0};
-		this->stream->readRaw(buffer, 4); // RIFF
-		this->stream->readRaw(buffer, 4); // file size
-		this->stream->readRaw(buffer, 4); // WAVE
-		hstr tag;
-		int size = 0;
-		while (!this->stream->eof())
+		this->_seek(this->dataOffset, hsbase::START);
+		this->dataRemaining = this->dataSize;
+		// ADPCM decoding state
+		this->blockFrames = 0;
+		this->blockPosition = 0;
+		this->framesRemaining = (this->channels > 0 ? this->size / (this->channels * 2) : 0);
+	}
+
+	bool WAV_Source::_decodeBlock()
+	{
+		if (this->dataRemaining <= 0 || this->framesRemaining <= 0)
 		{
-			this->stream->readRaw(buffer, 4); // next tag
-			tag = (char*)buffer;
-			this->stream->readRaw(buffer, 4); // size of the chunk
-			memcpy(&size, buffer, 4);
-			if (tag == "data")
+			return false;
+		}
+		int read = this->_readRaw(this->blockData, hmin(this->blockAlign, this->dataRemaining));
+		if (read <= 0)
+		{
+			return false;
+		}
+		this->dataRemaining -= read;
+		if (this->formatTag == WAV_FORMAT_IMA_ADPCM)
+		{
+			this->blockFrames = _decodeImaBlock(this->blockData, read, this->channels, this->blockSamples);
+		}
+		else
+		{
+			this->blockFrames = _decodeMsBlock(this->blockData, read, this->channels, this->coefficients, this->blockSamples);
+		}
+		this->blockFrames = hmin(this->blockFrames, this->framesRemaining);
+		this->framesRemaining -= this->blockFrames;
+		this->blockPosition = 0;
+		return (this->blockFrames > 0);
+	}
+
+	int WAV_Source::_decode(char* output, int size)
+	{
+		int frameSize = this->channels * 2;
+		int written = 0;
+		int count = 0;
+		if (this->_isAdpcm())
+		{
+			while (written + frameSize <= size)
+			{
+				if (this->blockPosition >= this->blockFrames && !this->_decodeBlock())
+				{
+					break;
+				}
+				count = hmin(this->blockFrames - this->blockPosition, (size - written) / frameSize);
+				memcpy(&output[written], &this->blockSamples[this->blockPosition * this->channels], count * frameSize);
+				this->blockPosition += count;
+				written += count * frameSize;
+			}
+			return written;
+		}
+		// conversion of 24 bit, 32 bit and float samples to 16 bit
+		int inputFrameSize = this->channels * this->sampleSize;
+		int frames = hmin(size / frameSize, this->dataRemaining / inputFrameSize);
+		int read = 0;
+		short* samples = (short*)output;
+		while (frames > 0)
+		{
+			count = hmin(frames, WAV_CONVERSION_BUFFER_SIZE / inputFrameSize);
+			read = this->_readRaw(this->blockData, count * inputFrameSize) / inputFrameSize;
+			if (read <= 0)
 			{
 				break;
 			}
-			if (size > 0)
+			this->dataRemaining -= read * inputFrameSize;
+			if (this->formatTag == WAV_FORMAT_IEEE_FLOAT)
+			{
+				_convertFloat32((float*)this->blockData, samples, read * this->channels);
+			}
+			else if (this->sampleSize == 3)
+			{
+				_convertPcm24(this->blockData, samples, read * this->channels);
+			}
+			else
+			{
+				_convertPcm32((int*)this->blockData, samples, read * this->channels);
+			}
+			samples += read * this->channels;
+			written += read * frameSize;
+			frames -= read;
+			if (read < count)
 			{
-				this->stream->seek(size);
+				break;
 			}
 		}
+		return written;
 	}
 
 	bool WAV_Source::load(hstream& output)
@@ -140,24 +591,105 @@ namespace xal
 		{
 			return false;
 		}
-		int written = output.writeRaw(*this->stream, this->size);
+		int written = 0;
+		if (!this->_isNative())
+		{
+			output.prepareManualWriteRaw(this->size);
+			char* buffer = (char*)output;
+			written = this->_decode(buffer, this->size);
+			if (written < this->size)
+			{
+				memset(&buffer[written], 0, this->size - written);
+			}
+			return (written > 0);
+		}
+		if (this->memory.data != NULL)
+		{
+			written = output.writeRaw(&this->memory.data[this->memory.position], (int)hmin((int64_t)this->dataRemaining, this->memory.size - this->memory.position));
+			this->memory.position += written;
+		}
+		else
+		{
+			written = output.writeRaw(*this->stream, this->dataRemaining);
+		}
 		if (written > 0)
 		{
+			this->dataRemaining -= written;
 			output.seek(-written);
 			return true;
 		}
 		return false;
 	}
 
+	bool WAV_Source::_loadDirect(unsigned char** data, int* size)
+	{
+		if (!this->_isNative())
+		{
+			return false;
+		}
+		int64_t available = 0;
+		unsigned char* memory = this->_getMemoryData(&available);
+		if (memory == NULL)
+		{
+			return false;
+		}
+		*data = memory;
+		*size = (int)hmin((int64_t)this->dataRemaining, available);
+		this->_seek(*size);
+		this->dataRemaining -= *size;
+		return true;
+	}
+
+	bool WAV_Source::_loadChunkDirect(unsigned char** data, int size)
+	{
+		if (!this->_isNative() || this->dataRemaining < size)
+		{
+			return false;
+		}
+		int64_t available = 0;
+		unsigned char* memory = this->_getMemoryData(&available);
+		if (memory == NULL || available < size)
+		{
+			return false;
+		}
+		*data = memory;
+		this->_seek(size);
+		this->dataRemaining -= size;
+		return true;
+	}
+
 	int WAV_Source::loadChunk(hstream& output, int size)
 	{
 		if (Source::loadChunk(output, size) == 0)
 		{
 			return 0;
 		}
-		int written = output.writeRaw(this->stream, size);
+		int written = 0;
+		if (!this->_isNative())
+		{
+			output.prepareManualWriteRaw(size);
+			written = this->_decode((char*)output, size);
+			output.truncate((int64_t)written); // if there wasn't enough data to fill the entire ouput buffer
+			return written;
+		}
+		// chunks following the data chunk must not be read as samples
+		size = hmin(size, this->dataRemaining);
+		if (size <= 0)
+		{
+			return 0;
+		}
+		if (this->memory.data != NULL)
+		{
+			written = output.writeRaw(&this->memory.data[this->memory.position], (int)hmin((int64_t)size, this->memory.size - this->memory.position));
+			this->memory.position += written;
+		}
+		else
+		{
+			written = output.writeRaw(this->stream, size);
+		}
 		if (written > 0)
 		{
+			this->dataRemaining -= written;
 			output.seek(-written);
 		}
 		return written;
@@ -14,6 +14,7 @@
 #ifndef XAL_WAV_SOURCE_H
 #define XAL_WAV_SOURCE_H
 
+#include <hltypes/harray.h>
 #include <hltypes/hresource.h>
 #include <hltypes/hstring.h>
 
@@ -21,6 +22,14 @@
 #include "Source.h"
 #include "xalExport.h"
 
+#define WAV_FORMAT_PCM 0x1
+#define WAV_FORMAT_MS_ADPCM 0x2
+#define WAV_FORMAT_IEEE_FLOAT 0x3
+#define WAV_FORMAT_IMA_ADPCM 0x11
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+#define WAV_ADPCM_MAX_CHANNELS 2
+#define WAV_CONVERSION_BUFFER_SIZE 16384
+
 namespace xal
 {
 	class xalExport WAV_Source : public Source
@@ -30,12 +39,60 @@ namespace xal
 		~WAV_Source();
 
 		bool open();
+		void close();
 		void rewind();
+		bool seek(int64_t samplePosition);
 		bool load(hstream& output);
 		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
 
 	protected:
+		/// @brief Format tag from the fmt chunk or the sub-format of an extensible fmt chunk.
+		unsigned short formatTag;
+		/// @brief Size of one stored PCM or float sample in bytes.
+		int sampleSize;
+		/// @brief Size of one encoded block.
+		int blockAlign;
+		/// @brief Position of the sample data in the file.
+		int64_t dataOffset;
+		/// @brief Size of the data chunk.
+		int dataSize;
+		/// @brief MS ADPCM predictor coefficient pairs.
+		harray<short> coefficients;
+		/// @brief Currently decoded ADPCM block or samples that are being converted.
+		unsigned char* blockData;
+		/// @brief Decoded samples of the current ADPCM block.
+		short* blockSamples;
+		/// @brief Number of decoded sample frames in the current ADPCM block.
+		int blockFrames;
+		/// @brief Number of sample frames already consumed from the current ADPCM block.
+		int blockPosition;
+		/// @brief Remaining bytes in the data chunk.
+		int dataRemaining;
+		/// @brief Remaining sample frames to decode.
+		int framesRemaining;
+
 		void _findData();
+		bool _loadDirect(unsigned char** data, int* size);
+		bool _loadChunkDirect(unsigned char** data, int size);
+		/// @brief Reads the format and data location from the chunk headers in a single pass.
+		/// @return True if the data is in a supported format.
+		bool _readMetaData();
+		/// @return True if the data is ADPCM encoded.
+		bool _isAdpcm();
+		/// @return True if the data can be used without decoding or conversion.
+		bool _isNative();
+		/// @brief Calculates how many sample frames an ADPCM block of the given size contains.
+		/// @param[in] blockSize Size of the block in bytes.
+		/// @return Number of sample frames.
+		int _getBlockFrames(int blockSize);
+		/// @brief Reads and decodes the next ADPCM block.
+		/// @return True if any samples were decoded.
+		bool _decodeBlock();
+		/// @brief Decodes ADPCM data or converts 24 bit, 32 bit and float samples into 16 bit PCM.
+		/// @param[in] output Output buffer.
+		/// @param[in] size Size of the output buffer in bytes.
+		/// @return Number of bytes written.
+		int _decode(char* output, int size);
 
 	};
 
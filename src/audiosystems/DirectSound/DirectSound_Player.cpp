@@ -88,7 +88,7 @@ namespace xal
 		memset(&bufferDesc, 0, sizeof(DSBUFFERDESC));
 		bufferDesc.dwSize = sizeof(DSBUFFERDESC);
 		bufferDesc.dwFlags = (DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLFREQUENCY | DSBCAPS_CTRLPOSITIONNOTIFY | DSBCAPS_GLOBALFOCUS);
-		bufferDesc.dwBufferBytes = (!this->sound->isStreamed() ? this->buffer->getSize() : STREAM_BUFFER);
+		bufferDesc.dwBufferBytes = (!this->buffer->isStreamed() ? this->buffer->getSize() : (this->streamBufferCount * this->streamBufferSize));
 		bufferDesc.lpwfxFormat = &wavefmt;
 		HRESULT result = ((DirectSound_AudioManager*)xal::manager)->dsDevice->CreateSoundBuffer(&bufferDesc, &this->dsBuffer, NULL);
 		if (FAILED(result))
@@ -101,13 +101,12 @@ namespace xal
 
 	void DirectSound_Player::_systemPrepareBuffer()
 	{
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
-			hstream& stream = this->buffer->getStream();
-			this->_copyBuffer(stream, (int)stream.size());
+			this->_copyBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			return;
 		}
-		int count = STREAM_BUFFER_COUNT;
+		int count = this->streamBufferCount;
 		if (!this->paused)
 		{
 			this->bufferIndex = 0;
@@ -122,26 +121,26 @@ namespace xal
 			this->bufferCount += count;
 			if (count > 0)
 			{
-				this->_copyBuffer(this->buffer->getStream(), STREAM_BUFFER_SIZE, count);
+				this->_copyBuffer(this->buffer->getData(), this->streamBufferSize, count);
 			}
-			if (this->bufferQueued < STREAM_BUFFER_COUNT)
+			if (this->bufferQueued < this->streamBufferCount)
 			{
-				count = STREAM_BUFFER_COUNT - this->bufferQueued;
-				this->_copySilence(STREAM_BUFFER_SIZE, count);
+				count = this->streamBufferCount - this->bufferQueued;
+				this->_copySilence(this->streamBufferSize, count);
 			}
 		}
 	}
 
-	void DirectSound_Player::_copyBuffer(hstream& stream, int size, int count)
+	void DirectSound_Player::_copyBuffer(unsigned char* data, int size, int count)
 	{
 		void* write1 = NULL;
 		void* write2 = NULL;
 		unsigned long length1;
 		unsigned long length2;
 		int lockOffset = 0;
-		if (this->sound->isStreamed())
+		if (this->buffer->isStreamed())
 		{
-			lockOffset = this->bufferIndex * STREAM_BUFFER_SIZE;
+			lockOffset = this->bufferIndex * this->streamBufferSize;
 		}
 		HRESULT result = this->dsBuffer->Lock(lockOffset, size * count, &write1, &length1, &write2, &length2, 0);
 		if (FAILED(result))
@@ -151,16 +150,16 @@ namespace xal
 		}
 		if (write1 != NULL)
 		{
-			memcpy(write1, &stream[0], length1);
+			memcpy(write1, &data[0], length1);
 		}
 		if (write2 != NULL)
 		{
-			memcpy(write2, &stream[length1], length2);
+			memcpy(write2, &data[length1], length2);
 		}
 		this->dsBuffer->Unlock(write1, length1, write2, length2);
-		if (this->sound->isStreamed())
+		if (this->buffer->isStreamed())
 		{
-			this->bufferIndex = (this->bufferIndex + count) % STREAM_BUFFER_COUNT;
+			this->bufferIndex = (this->bufferIndex + count) % this->streamBufferCount;
 			this->bufferQueued += count;
 		}
 	}
@@ -172,9 +171,9 @@ namespace xal
 		unsigned long length1;
 		unsigned long length2;
 		int lockOffset = 0;
-		if (this->sound->isStreamed())
+		if (this->buffer->isStreamed())
 		{
-			lockOffset = this->bufferIndex * STREAM_BUFFER_SIZE;
+			lockOffset = this->bufferIndex * this->streamBufferSize;
 		}
 		HRESULT result = this->dsBuffer->Lock(lockOffset, size * count, &write1, &length1, &write2, &length2, 0);
 		if (FAILED(result))
@@ -191,9 +190,9 @@ namespace xal
 			memset(write2, 0, length2);
 		}
 		this->dsBuffer->Unlock(write1, length1, write2, length2);
-		if (this->sound->isStreamed())
+		if (this->buffer->isStreamed())
 		{
-			this->bufferIndex = (this->bufferIndex + count) % STREAM_BUFFER_COUNT;
+			this->bufferIndex = (this->bufferIndex + count) % this->streamBufferCount;
 			this->bufferQueued += count;
 		}
 	}
@@ -222,11 +221,45 @@ namespace xal
 		}
 	}
 
+	bool DirectSound_Player::_systemSeek(unsigned int samplePosition)
+	{
+		if (this->dsBuffer == NULL)
+		{
+			return false;
+		}
+		if (!this->buffer->isStreamed())
+		{
+			this->_systemSetOffset(samplePosition * this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f);
+			return true;
+		}
+		bool playing = this->_systemIsPlaying();
+		// the data has to be copied from the start of the buffer, decoding first limits the gap to the restart
+		this->bufferIndex = 0;
+		int count = this->_fillBuffers(this->bufferIndex, this->streamBufferCount);
+		this->dsBuffer->Stop();
+		this->_systemSetOffset(0);
+		this->bufferCount = count;
+		this->bufferQueued = 0;
+		if (count > 0)
+		{
+			this->_copyBuffer(this->buffer->getData(), this->streamBufferSize, count);
+		}
+		if (this->bufferQueued < this->streamBufferCount)
+		{
+			this->_copySilence(this->streamBufferSize, this->streamBufferCount - this->bufferQueued);
+		}
+		if (playing)
+		{
+			this->_systemPlay();
+		}
+		return true;
+	}
+
 	void DirectSound_Player::_systemPlay()
 	{
 		if (this->dsBuffer != NULL)
 		{
-			this->dsBuffer->Play(0, 0, ((this->looping || this->sound->isStreamed()) ? DSBPLAY_LOOPING : 0));
+			this->dsBuffer->Play(0, 0, ((this->looping || this->buffer->isStreamed()) ? DSBPLAY_LOOPING : 0));
 		}
 	}
 
@@ -236,15 +269,15 @@ namespace xal
 		if (this->dsBuffer != NULL)
 		{
 			this->dsBuffer->Stop();
-			if (this->sound->isStreamed())
+			if (this->buffer->isStreamed())
 			{
 				if (this->paused)
 				{
 					int processed = this->_getProcessedBuffersCount();
-					this->bufferIndex = (this->bufferIndex + processed) % STREAM_BUFFER_COUNT;
+					this->bufferIndex = (this->bufferIndex + processed) % this->streamBufferCount;
 					this->bufferCount -= processed;
 					this->bufferQueued -= processed;
-					result = processed * STREAM_BUFFER_SIZE;
+					result = processed * this->streamBufferSize;
 				}
 				else
 				{
@@ -279,32 +312,32 @@ namespace xal
 		int count = this->_fillBuffers(this->bufferIndex, processed);
 		if (count > 0)
 		{
-			this->_copyBuffer(this->buffer->getStream(), STREAM_BUFFER_SIZE, count);
+			this->_copyBuffer(this->buffer->getData(), this->streamBufferSize, count);
 			this->bufferCount += count;
 		}
-		if (!this->looping && this->bufferQueued < STREAM_BUFFER_COUNT)
+		if (!this->looping && this->bufferQueued < this->streamBufferCount)
 		{
-			count = STREAM_BUFFER_COUNT - this->bufferQueued;
-			this->_copySilence(STREAM_BUFFER_SIZE, count);
+			count = this->streamBufferCount - this->bufferQueued;
+			this->_copySilence(this->streamBufferSize, count);
 		}
 		if (this->bufferCount == 0)
 		{
 			this->_stop();
 			processed = 0;
 		}
-		return (processed * STREAM_BUFFER_SIZE);
+		return (processed * this->streamBufferSize);
 	}
 
 	int DirectSound_Player::_getProcessedBuffersCount()
 	{
-		return ((this->_systemGetBufferPosition() / STREAM_BUFFER_SIZE +
-			STREAM_BUFFER_COUNT - this->bufferIndex) % STREAM_BUFFER_COUNT);
+		return ((this->_systemGetBufferPosition() / this->streamBufferSize +
+			this->streamBufferCount - this->bufferIndex) % this->streamBufferCount);
 	}
 
 	int DirectSound_Player::_fillBuffers(int index, int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		return (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		return (size + this->streamBufferSize - 1) / this->streamBufferSize;
 	}
 
 }
@@ -43,13 +43,14 @@ namespace xal
 		void _systemPrepareBuffer();
 		void _systemUpdateGain();
 		void _systemUpdatePitch();
+		bool _systemSeek(unsigned int samplePosition);
 		void _systemPlay();
 		int _systemStop();
 		int _systemUpdateStream();
 
 		int _getProcessedBuffersCount();
 		int _fillBuffers(int index, int count);
-		void _copyBuffer(hstream& stream, int size, int count = 1);
+		void _copyBuffer(unsigned char* data, int size, int count = 1);
 		void _copySilence(int size, int count = 1);
 
 	};
@@ -31,6 +31,7 @@ namespace xal
 		bool playing;
 
 		bool _systemIsPlaying();
+		inline bool _systemSeek(unsigned int samplePosition) { return true; }
 		void _systemPlay();
 		int _systemStop();
 
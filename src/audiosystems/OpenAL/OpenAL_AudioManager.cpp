@@ -174,6 +174,34 @@ namespace xal
 	{
 		return new OpenAL_Player(sound);
 	}
+
+	void OpenAL_AudioManager::_systemPlayGroup(harray<Player*> players)
+	{
+		harray<OpenAL_Player*> openAlPlayers = players.cast<OpenAL_Player*>();
+		unsigned int* sourceIds = new unsigned int[openAlPlayers.size()];
+		int count = 0;
+		foreach (OpenAL_Player*, it, openAlPlayers)
+		{
+			if ((*it)->sourceId != 0)
+			{
+				sourceIds[count] = (*it)->sourceId;
+				++count;
+			}
+		}
+		if (count > 0)
+		{
+			// all sources are started atomically on the same frame
+			alSourcePlayv(count, sourceIds);
+		}
+		delete [] sourceIds;
+		foreach (OpenAL_Player*, it, openAlPlayers)
+		{
+			if ((*it)->sourceId != 0)
+			{
+				(*it)->_finishSystemPlay();
+			}
+		}
+	}
 	
 	unsigned int OpenAL_AudioManager::_allocateSourceId()
 	{
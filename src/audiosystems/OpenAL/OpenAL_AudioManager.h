@@ -51,6 +51,7 @@ namespace xal
 		int numActiveSources;
 
 		Player* _createSystemPlayer(Sound* sound);
+		void _systemPlayGroup(harray<Player*> players);
 		unsigned int _allocateSourceId();
 		void _releaseSourceId(unsigned int sourceId);
 #ifdef _IOS
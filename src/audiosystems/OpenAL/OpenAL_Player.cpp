@@ -30,6 +30,8 @@ namespace xal
 	OpenAL_Player::OpenAL_Player(Sound* sound) : Player(sound), sourceId(0)
 	{
 		this->pendingPitchUpdate = false;
+		// non-streamed Players use only one buffer
+		this->bufferIds = new unsigned int[!this->buffer->isStreamed() ? 1 : this->streamBufferCount];
 		this->createOpenALBuffers();
 #ifdef _MAC
 		this->macSampleOffset = -1;
@@ -40,17 +42,18 @@ namespace xal
 	{
 		// AudioManager calls _stop before destruction
 		this->destroyOpenALBuffers();
+		delete [] this->bufferIds;
 	}
 	
 	void OpenAL_Player::createOpenALBuffers()
 	{
-		memset(this->bufferIds, 0, STREAM_BUFFER_COUNT * sizeof(unsigned int));
-		alGenBuffers((!this->sound->isStreamed() ? 1 : STREAM_BUFFER_COUNT), this->bufferIds);
+		memset(this->bufferIds, 0, (!this->buffer->isStreamed() ? 1 : this->streamBufferCount) * sizeof(unsigned int));
+		alGenBuffers((!this->buffer->isStreamed() ? 1 : this->streamBufferCount), this->bufferIds);
 	}
 
 	void OpenAL_Player::destroyOpenALBuffers()
 	{
-		alDeleteBuffers((!this->sound->isStreamed() ? 1 : STREAM_BUFFER_COUNT), this->bufferIds);
+		alDeleteBuffers((!this->buffer->isStreamed() ? 1 : this->streamBufferCount), this->bufferIds);
 	}
 	
 	void OpenAL_Player::_update(float timeDelta)
@@ -62,13 +65,22 @@ namespace xal
 		}
 	}
 	
+	float OpenAL_Player::_calcUpdateDelay()
+	{
+		if (!this->_isPlaying() && this->sourceId != 0) // the source has to be released
+		{
+			return 0.0f;
+		}
+		return Player::_calcUpdateDelay();
+	}
+
 	bool OpenAL_Player::_systemIsPlaying()
 	{
 		if (this->sourceId == 0)
 		{
 			return false;
 		}
-		if (this->sound->isStreamed())
+		if (this->buffer->isStreamed())
 		{
 			return (this->_getQueuedBuffersCount() > 0 || this->_getProcessedBuffersCount() > 0);
 		}
@@ -84,11 +96,11 @@ namespace xal
 		{
 			alGetSourcei(this->sourceId, AL_BYTE_OFFSET, &bytes);
 		}
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
 			return bytes;
 		}
-		return ((bytes + this->bufferIndex * STREAM_BUFFER_SIZE) % STREAM_BUFFER);
+		return ((bytes + this->bufferIndex * this->streamBufferSize) % (this->streamBufferCount * this->streamBufferSize));
 	}
 	
 	float OpenAL_Player::_systemGetOffset()
@@ -106,7 +118,7 @@ namespace xal
 #ifndef __APPLE__
 		if (this->sourceId != 0)
 #else
-		if (this->sourceId != 0 && !this->sound->isStreamed()) // Hack for iOS and Mac because apple has a bug in OpenAL and setting offset when buffers are queued messes up stuff and causes crashes.
+		if (this->sourceId != 0 && !this->buffer->isStreamed()) // Hack for iOS and Mac because apple has a bug in OpenAL and setting offset when buffers are queued messes up stuff and causes crashes.
 #endif
 		{
 #ifdef _MAC
@@ -141,7 +153,7 @@ namespace xal
 	void OpenAL_Player::_systemPrepareBuffer()
 	{
 		// making sure all buffer data is loaded before accessing anything
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
 			this->_fillBuffers(0, 1);
 			alSourcei(this->sourceId, AL_BUFFER, this->bufferIds[0]);
@@ -151,14 +163,14 @@ namespace xal
 		{
 			alSourcei(this->sourceId, AL_BUFFER, AL_NONE);
 			alSourcei(this->sourceId, AL_LOOPING, false);
-			int count = STREAM_BUFFER_COUNT - this->_getQueuedBuffersCount();
+			int count = this->queuedBufferCount - this->_getQueuedBuffersCount();
 			if (count > 0)
 			{
 				count = this->_fillBuffers(this->bufferIndex, count);
 				if (count > 0)
 				{
 					this->_queueBuffers(this->bufferIndex, count);
-					this->bufferIndex = (this->bufferIndex + count) % STREAM_BUFFER_COUNT;
+					this->bufferIndex = (this->bufferIndex + count) % this->streamBufferCount;
 				}
 			}
 		}
@@ -184,23 +196,61 @@ namespace xal
 		}
 	}
 	
+	bool OpenAL_Player::_systemSeek(unsigned int samplePosition)
+	{
+		if (this->sourceId == 0)
+		{
+			return false;
+		}
+		if (!this->buffer->isStreamed())
+		{
+			this->_systemSetOffset((float)samplePosition);
+			return true;
+		}
+		int state = 0;
+		alGetSourcei(this->sourceId, AL_SOURCE_STATE, &state);
+		// OpenAL can't replace queued buffers while the source plays, decoding first limits the gap to the restart
+		int size = this->buffer->load(this->looping, this->queuedBufferCount * this->streamBufferSize);
+		// stopping marks all queued buffers as processed so they can be unqueued
+		alSourceStop(this->sourceId);
+		this->_unqueueBuffers();
+		alSourcei(this->sourceId, AL_BUFFER, AL_NONE);
+		this->bufferIndex = 0;
+		int count = this->_uploadBuffers(this->bufferIndex, size);
+		if (count > 0)
+		{
+			this->_queueBuffers(this->bufferIndex, count);
+			this->bufferIndex = count % this->streamBufferCount;
+		}
+		if (state == AL_PLAYING)
+		{
+			alSourcePlay(this->sourceId);
+		}
+		return true;
+	}
+
 	void OpenAL_Player::_systemPlay()
 	{
 		if (this->sourceId != 0)
 		{
 			alSourcePlay(this->sourceId);
+			this->_finishSystemPlay();
+		}
+	}
+
+	void OpenAL_Player::_finishSystemPlay()
+	{
 #ifdef _MAC
-			if (this->macSampleOffset >= 0)
-			{
-				alSourcef(this->sourceId, AL_SAMPLE_OFFSET, this->macSampleOffset);
-				this->macSampleOffset = -1;
-			}
+		if (this->macSampleOffset >= 0)
+		{
+			alSourcef(this->sourceId, AL_SAMPLE_OFFSET, this->macSampleOffset);
+			this->macSampleOffset = -1;
+		}
 #endif
-			if (this->pendingPitchUpdate)
-			{
-				this->pendingPitchUpdate = false;
-				alSourcef(this->sourceId, AL_PITCH, this->pitch);
-			}
+		if (this->pendingPitchUpdate)
+		{
+			this->pendingPitchUpdate = false;
+			alSourcef(this->sourceId, AL_PITCH, this->pitch);
 		}
 	}
 	
@@ -209,7 +259,7 @@ namespace xal
 		int result = 0;
 		if (this->sourceId != 0)
 		{
-			if (!this->sound->isStreamed())
+			if (!this->buffer->isStreamed())
 			{
 				alSourceStop(this->sourceId);
 				alSourcei(this->sourceId, AL_BUFFER, AL_NONE); // necessary to avoid a memory leak in OpenAL
@@ -224,8 +274,8 @@ namespace xal
 				alSourcei(this->sourceId, AL_BUFFER, AL_NONE); // necessary to avoid a memory leak in OpenAL
 				if (this->paused)
 				{
-					this->bufferIndex = (this->bufferIndex + processed) % STREAM_BUFFER_COUNT;
-					result = processed * STREAM_BUFFER_SIZE;
+					this->bufferIndex = (this->bufferIndex + processed) % this->streamBufferCount;
+					result = processed * this->streamBufferSize;
 				}
 				else
 				{
@@ -240,11 +290,37 @@ namespace xal
 	}
 	
 	int OpenAL_Player::_systemUpdateStream()
+	{
+		int result = this->_systemFeedStream();
+		if (this->streamEnded)
+		{
+			this->streamEnded = false;
+			this->streamUnderrun = false;
+			this->_stop();
+		}
+		else if (this->streamUnderrun) // underrun happened, sound was stopped by OpenAL so let's reboot it properly
+		{
+			this->streamUnderrun = false;
+			this->_registerUnderrun();
+			this->_restartStream();
+		}
+		return result;
+	}
+
+	int OpenAL_Player::_systemFeedStream()
 	{
 		int queued = this->_getQueuedBuffersCount();
 		if (queued == 0)
 		{
-			this->_stop();
+			// if the decoding didn't keep up, the stream isn't over yet
+			if (this->buffer->isDecodingAhead())
+			{
+				this->streamUnderrun = true;
+			}
+			else
+			{
+				this->streamEnded = true;
+			}
 			return 0;
 		}
 		int processed = this->_getProcessedBuffersCount();
@@ -252,13 +328,18 @@ namespace xal
 		{
 			return 0;
 		}
-		this->_unqueueBuffers((this->bufferIndex + STREAM_BUFFER_COUNT - queued) % STREAM_BUFFER_COUNT, processed);
-		int count = this->_fillBuffers(this->bufferIndex, processed);
+		this->_unqueueBuffers((this->bufferIndex + this->streamBufferCount - queued) % this->streamBufferCount, processed);
+		// refills only as many buffers as needed to reach the number of queued buffers, since it can change with adaptive buffering
+		int count = this->queuedBufferCount - queued + processed;
+		if (count > 0)
+		{
+			count = this->_fillBuffers(this->bufferIndex, count);
+		}
 		if (count > 0)
 		{
 			this->_queueBuffers(this->bufferIndex, count);
-			this->bufferIndex = (this->bufferIndex + count) % STREAM_BUFFER_COUNT;
-			bool playing = (processed < STREAM_BUFFER_COUNT);
+			this->bufferIndex = (this->bufferIndex + count) % this->streamBufferCount;
+			bool playing = (processed < queued);
 			if (playing)
 			{
 				int state;
@@ -268,22 +349,24 @@ namespace xal
 					playing = false;
 				}
 			}
-			if (!playing) // underrun happened, sound was stopped by OpenAL so let's reboot it properly
+			if (!playing)
 			{
-				float speed = this->fadeSpeed;
-				float time = this->fadeTime;
-				this->_pause();
-				this->_play();
-				this->fadeSpeed = speed;
-				this->fadeTime = time;
+				this->streamUnderrun = true;
 			}
 		}
 		if (this->_getQueuedBuffersCount() == 0)
 		{
-			this->_stop();
-			processed = 0;
+			if (this->buffer->isDecodingAhead())
+			{
+				this->streamUnderrun = true;
+			}
+			else
+			{
+				this->streamEnded = true;
+				processed = 0;
+			}
 		}
-		return (processed * STREAM_BUFFER_SIZE);
+		return (processed * this->streamBufferSize);
 	}
 	
 	int OpenAL_Player::_getQueuedBuffersCount()
@@ -308,45 +391,51 @@ namespace xal
 	
 	int OpenAL_Player::_fillBuffers(int index, int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		hstream& stream = this->buffer->getStream();
-		if (!this->sound->isStreamed())
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		unsigned char* data = this->buffer->getData();
+		if (!this->buffer->isStreamed())
 		{
 			alBufferData(this->bufferIds[index], (this->buffer->getChannels() == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16),
-				(unsigned char*)stream, size, this->buffer->getSamplingRate());
+				data, size, this->buffer->getSamplingRate());
 			return 1;
 		}
-		int filled = (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
+		return this->_uploadBuffers(index, size);
+	}
+	
+	int OpenAL_Player::_uploadBuffers(int index, int size)
+	{
+		unsigned char* data = this->buffer->getData();
+		int filled = (size + this->streamBufferSize - 1) / this->streamBufferSize;
 		unsigned int format = (this->buffer->getChannels() == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16);
 		int samplingRate = this->buffer->getSamplingRate();
 		for_iter (i, 0, filled)
 		{
-			alBufferData(this->bufferIds[(index + i) % STREAM_BUFFER_COUNT], format,
-				&stream[i * STREAM_BUFFER_SIZE], hmin(size, STREAM_BUFFER_SIZE), samplingRate);
-			size -= STREAM_BUFFER_SIZE;
+			alBufferData(this->bufferIds[(index + i) % this->streamBufferCount], format,
+				&data[i * this->streamBufferSize], hmin(size, this->streamBufferSize), samplingRate);
+			size -= this->streamBufferSize;
 		}
 		return filled;
 	}
 	
 	void OpenAL_Player::_queueBuffers(int index, int count)
 	{
-		if (index + count <= STREAM_BUFFER_COUNT)
+		if (index + count <= this->streamBufferCount)
 		{
 			alSourceQueueBuffers(this->sourceId, count, &this->bufferIds[index]);
 		}
 		else
 		{
-			alSourceQueueBuffers(this->sourceId, STREAM_BUFFER_COUNT - index, &this->bufferIds[index]);
-			alSourceQueueBuffers(this->sourceId, count + index - STREAM_BUFFER_COUNT, this->bufferIds);
+			alSourceQueueBuffers(this->sourceId, this->streamBufferCount - index, &this->bufferIds[index]);
+			alSourceQueueBuffers(this->sourceId, count + index - this->streamBufferCount, this->bufferIds);
 		}
 	}
  	
 	void OpenAL_Player::_queueBuffers()
 	{
 		int queued = this->_getQueuedBuffersCount();
-		if (queued < STREAM_BUFFER_COUNT)
+		if (queued < this->queuedBufferCount)
 		{
-			this->_queueBuffers(this->bufferIndex, STREAM_BUFFER_COUNT - queued);
+			this->_queueBuffers(this->bufferIndex, this->queuedBufferCount - queued);
 		}
 	}
  	
@@ -356,7 +445,7 @@ namespace xal
 		int n = this->_getQueuedBuffersCount();
 		int safeWait = 50;
 #endif
-		if (index + count <= STREAM_BUFFER_COUNT)
+		if (index + count <= this->streamBufferCount)
 		{
 			alSourceUnqueueBuffers(this->sourceId, count, &this->bufferIds[index]);
 #ifdef __APPLE__
@@ -375,9 +464,9 @@ namespace xal
 		}
 		else
 		{
-			alSourceUnqueueBuffers(this->sourceId, STREAM_BUFFER_COUNT - index, &this->bufferIds[index]);
+			alSourceUnqueueBuffers(this->sourceId, this->streamBufferCount - index, &this->bufferIds[index]);
 #ifdef __APPLE__
-			while (n - this->_getQueuedBuffersCount() != STREAM_BUFFER_COUNT - index && safeWait > 0)
+			while (n - this->_getQueuedBuffersCount() != this->streamBufferCount - index && safeWait > 0)
 			{
 				hthread::sleep(1);
 				--safeWait;
@@ -389,12 +478,12 @@ namespace xal
 				alSourcei(this->sourceId, AL_BUFFER, AL_NONE);
 				return;
 			}
-			n -= STREAM_BUFFER_COUNT - index;
+			n -= this->streamBufferCount - index;
 #endif
-			alSourceUnqueueBuffers(this->sourceId, count + index - STREAM_BUFFER_COUNT, this->bufferIds);
+			alSourceUnqueueBuffers(this->sourceId, count + index - this->streamBufferCount, this->bufferIds);
 #ifdef __APPLE__
 			safeWait = 50;
-			while (n - this->_getQueuedBuffersCount() != count + index - STREAM_BUFFER_COUNT && safeWait > 0)
+			while (n - this->_getQueuedBuffersCount() != count + index - this->streamBufferCount && safeWait > 0)
 			{
 				hthread::sleep(1);
 				--safeWait;
@@ -414,7 +503,7 @@ namespace xal
 		int queued = this->_getQueuedBuffersCount();
 		if (queued > 0)
 		{
-			this->_unqueueBuffers((this->bufferIndex + STREAM_BUFFER_COUNT - queued) % STREAM_BUFFER_COUNT, queued);
+			this->_unqueueBuffers((this->bufferIndex + this->streamBufferCount - queued) % this->streamBufferCount, queued);
 		}
 	}
 	
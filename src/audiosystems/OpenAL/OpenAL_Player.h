@@ -38,9 +38,10 @@ namespace xal
 		void destroyOpenALBuffers();
 	protected:
 		unsigned int sourceId;
-		unsigned int bufferIds[STREAM_BUFFER_COUNT];
+		unsigned int* bufferIds;
 
 		void _update(float timeDelta);
+		float _calcUpdateDelay();
 
 		bool _systemIsPlaying();
 		unsigned int _systemGetBufferPosition();
@@ -50,13 +51,18 @@ namespace xal
 		void _systemPrepareBuffer();
 		void _systemUpdateGain();
 		void _systemUpdatePitch();
+		bool _systemSeek(unsigned int samplePosition);
 		void _systemPlay();
+		void _finishSystemPlay();
 		int _systemStop();
+		inline bool _systemSupportsStreamFeeding() { return true; }
+		int _systemFeedStream();
 		int _systemUpdateStream();
 
 		int _getQueuedBuffersCount();
 		int _getProcessedBuffersCount();
 		int _fillBuffers(int index, int count);
+		int _uploadBuffers(int index, int size);
 		void _queueBuffers(int index, int count);
 		void _queueBuffers();
 		void _unqueueBuffers(int index, int count);
@@ -56,7 +56,7 @@ namespace xal
 		if (event & SL_PLAYEVENT_HEADATEND)
 		{
 			OpenSLES_Player* player = (OpenSLES_Player*)context;
-			if (!player->sound->isStreamed())
+			if (!player->buffer->isStreamed())
 			{
 				player->active = false;
 			}
@@ -66,15 +66,13 @@ namespace xal
 	OpenSLES_Player::OpenSLES_Player(Sound* sound) : Player(sound), playing(false), active(false), stillPlaying(false),
 		playerObject(NULL), player(NULL), playerVolume(NULL), playerBufferQueue(NULL)
 	{
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		this->streamBuffers = NULL;
+		if (this->buffer->isStreamed())
 		{
-			this->streamBuffers[i] = NULL;
-		}
-		if (this->sound->isStreamed())
-		{
-			for_iter (i, 0, STREAM_BUFFER_COUNT)
+			this->streamBuffers = new unsigned char*[this->streamBufferCount];
+			for_iter (i, 0, this->streamBufferCount)
 			{
-				this->streamBuffers[i] = new unsigned char[STREAM_BUFFER_SIZE];
+				this->streamBuffers[i] = new unsigned char[this->streamBufferSize];
 			}
 		}
 	}
@@ -85,13 +83,14 @@ namespace xal
 		{
 			__CPP_WRAP(this->playerObject, Destroy);
 		}
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		if (this->streamBuffers != NULL)
 		{
-			if (this->streamBuffers[i] != NULL)
+			for_iter (i, 0, this->streamBufferCount)
 			{
 				delete[] this->streamBuffers[i];
-				this->streamBuffers[i] = NULL;
 			}
+			delete[] this->streamBuffers;
+			this->streamBuffers = NULL;
 		}
 	}
 	
@@ -119,7 +118,7 @@ namespace xal
 		{
 			// first comes "* 0.001", because it can cause an int overflow otherwise
 			bytes = (int)(milliseconds * 0.001f * this->buffer->getSamplingRate() * (this->buffer->getBitsPerSample() / 8) * this->buffer->getChannels());
-			if (!this->sound->isStreamed() && this->looping)
+			if (!this->buffer->isStreamed() && this->looping)
 			{
 				bytes %= this->buffer->getSize();
 			}
@@ -141,7 +140,7 @@ namespace xal
 		// input / source
 		SLDataLocator_AndroidSimpleBufferQueue inLocator;
 		inLocator.locatorType = SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE;
-		inLocator.numBuffers = (!this->sound->isStreamed() ? NORMAL_BUFFER_COUNT : STREAM_BUFFER_COUNT);
+		inLocator.numBuffers = (!this->buffer->isStreamed() ? NORMAL_BUFFER_COUNT : this->streamBufferCount);
 		SLDataFormat_PCM format;
 		format.formatType = SL_DATAFORMAT_PCM;
 		format.numChannels = this->buffer->getChannels();
@@ -216,13 +215,13 @@ namespace xal
 	
 	void OpenSLES_Player::_systemPrepareBuffer()
 	{
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
 			if (!this->looping)
 			{
 				if (!this->paused)
 				{
-					this->_submitBuffer(this->buffer->getStream());
+					this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 				}
 				return;
 			}
@@ -237,11 +236,11 @@ namespace xal
 			}
 			for_iter (i, 0, count)
 			{
-				this->_submitBuffer(this->buffer->getStream());
+				this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			}
 			return;
 		}
-		int count = STREAM_BUFFER_COUNT;
+		int count = this->streamBufferCount;
 		if (this->paused)
 		{
 			count -= this->buffersSubmitted;
@@ -365,7 +364,7 @@ namespace xal
 			this->buffersSubmitted -= processed;
 			for_iter (i, 0, processed)
 			{
-				this->_submitBuffer(this->buffer->getStream());
+				this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			}
 			this->stillPlaying = true; // in case underrun happened, sound is regarded as stopped so let's just bitch-slap it and get this over with
 			if (this->buffersSubmitted == 0)
@@ -383,10 +382,15 @@ namespace xal
 			this->stillPlaying = true; // don't remove, it prevents streamed sounds from being stopped
 			return 0;
 		}
+		bool underrun = (processed >= this->buffersSubmitted);
 		this->buffersSubmitted -= processed;
 		int count = this->_fillStreamBuffers(processed);
 		if (count > 0)
 		{
+			if (underrun)
+			{
+				this->_registerUnderrun();
+			}
 			this->_submitStreamBuffers(count);
 			this->stillPlaying = true; // in case underrun happened, sound is regarded as stopped so let's just bitch-slap it and get this over with
 		}
@@ -397,9 +401,9 @@ namespace xal
 		return 0;
 	}
 
-	void OpenSLES_Player::_submitBuffer(hstream& stream)
+	void OpenSLES_Player::_submitBuffer(unsigned char* data, int size)
 	{
-		SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, (unsigned char*)stream, (int)stream.size());
+		SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, data, size);
 		if (result == SL_RESULT_SUCCESS)
 		{
 			++this->buffersSubmitted;
@@ -412,20 +416,20 @@ namespace xal
 
 	int OpenSLES_Player::_fillStreamBuffers(int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		int filled = (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
-		hstream& stream = this->buffer->getStream();
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		int filled = (size + this->streamBufferSize - 1) / this->streamBufferSize;
+		unsigned char* data = this->buffer->getData();
 		int currentSize = 0;
 		for_iter (i, 0, filled)
 		{
-			currentSize = hmin(size, STREAM_BUFFER_SIZE);
-			memcpy(this->streamBuffers[this->bufferIndex], &stream[i * STREAM_BUFFER_SIZE], currentSize);
-			if (currentSize < STREAM_BUFFER_SIZE)
+			currentSize = hmin(size, this->streamBufferSize);
+			memcpy(this->streamBuffers[this->bufferIndex], &data[i * this->streamBufferSize], currentSize);
+			if (currentSize < this->streamBufferSize)
 			{
-				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, STREAM_BUFFER_SIZE - currentSize);
+				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, this->streamBufferSize - currentSize);
 			}
-			this->bufferIndex = (this->bufferIndex + 1) % STREAM_BUFFER_COUNT;
-			size -= STREAM_BUFFER_SIZE;
+			this->bufferIndex = (this->bufferIndex + 1) % this->streamBufferCount;
+			size -= this->streamBufferSize;
 		}
 		return filled;
 	}
@@ -433,17 +437,17 @@ namespace xal
 	void OpenSLES_Player::_submitStreamBuffers(int count)
 	{
 		int queued = 0;
-		int index = (this->bufferIndex + STREAM_BUFFER_COUNT - count) % STREAM_BUFFER_COUNT;
+		int index = (this->bufferIndex + this->streamBufferCount - count) % this->streamBufferCount;
 		for_iter (i, 0, count)
 		{
-			SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, this->streamBuffers[index], STREAM_BUFFER_SIZE);
+			SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, this->streamBuffers[index], this->streamBufferSize);
 			if (result != SL_RESULT_SUCCESS)
 			{
 				hlog::warn(xal::logTag, "Could not queue streamed buffer!");
 				break;
 			}
 			++queued;
-			index = (index + 1) % STREAM_BUFFER_COUNT;
+			index = (index + 1) % this->streamBufferCount;
 		}
 		this->buffersSubmitted += queued;
 	}
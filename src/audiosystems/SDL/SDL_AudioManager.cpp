@@ -23,7 +23,7 @@
 namespace xal
 {
 	SDL_AudioManager::SDL_AudioManager(void* backendId, bool threaded, float updateTime, chstr deviceName) :
-		AudioManager(backendId, threaded, updateTime, deviceName)
+		AudioManager(backendId, threaded, updateTime, deviceName), outputSampleTime(0)
 	{
 		this->name = XAL_AS_SDL;
 		hlog::write(xal::logTag, "Initializing SDL Audio.");
@@ -84,6 +84,12 @@ namespace xal
 		// the following line is here only for demonstration how it would look like with SDL_MixAudio
 		//SDL_MixAudio(stream, this->buffer, this->bufferSize, SDL_MIX_MAXVOLUME);
 		memcpy(stream, (unsigned char*)this->buffer, length);
+		this->outputSampleTime += length / (this->format.channels * this->bitsPerSample / 8);
+	}
+
+	int64_t SDL_AudioManager::_getOutputSampleTime()
+	{
+		return this->outputSampleTime;
 	}
 
 	void SDL_AudioManager::_mixAudio(void* unused, unsigned char* stream, int length)
@@ -91,9 +97,16 @@ namespace xal
 		((SDL_AudioManager*)xal::manager)->mixAudio(unused, stream, length);
 	}
 	
+	bool SDL_AudioManager::_isConversionRequired(Source* source)
+	{
+		SDL_AudioSpec format = this->getFormat();
+		int srcFormat = (source->getBitsPerSample() == 16 ? AUDIO_S16 : AUDIO_S8);
+		return (srcFormat != format.format || source->getChannels() != format.channels || source->getSamplingRate() != format.freq);
+	}
+
 	void SDL_AudioManager::_convertStream(Source* source, hstream& stream)
 	{	
-		if (stream.size() == 0)
+		if (stream.size() == 0 || !this->_isConversionRequired(source))
 		{
 			return;
 		}
@@ -101,10 +114,6 @@ namespace xal
 		int srcFormat = (source->getBitsPerSample() == 16 ? AUDIO_S16 : AUDIO_S8);
 		int srcChannels = source->getChannels();
 		int srcSamplingRate = source->getSamplingRate();
-		if (srcFormat == format.format && srcChannels == format.channels && srcSamplingRate == format.freq)
-		{
-			return;
-		}
 		SDL_AudioCVT cvt;
 		cvt.buf = NULL;
 		int result = SDL_BuildAudioCVT(&cvt, srcFormat, srcChannels, srcSamplingRate, format.format, format.channels, format.freq);
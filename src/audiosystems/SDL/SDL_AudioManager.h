@@ -46,12 +46,15 @@ namespace xal
 	protected:
 		SDL_AudioSpec format;
 		hstream buffer;
+		int64_t outputSampleTime; // number of samples mixed so far
 
 		Player* _createSystemPlayer(Sound* sound);
+		int64_t _getOutputSampleTime();
 
 		static void _mixAudio(void* unused, unsigned char* stream, int length);
 
 		void _convertStream(Source* source, hstream& stream);
+		bool _isConversionRequired(Source* source);
 		
 	};
 
@@ -20,19 +20,29 @@
 namespace xal
 {
 	SDL_Player::SDL_Player(Sound* sound) : Player(sound), playing(false),
-		position(0), currentGain(1.0f), readPosition(0), writePosition(0)
+		position(0), currentGain(1.0f), circleBuffer(NULL), circleBufferSize(0), readPosition(0), writePosition(0), startTime(-1)
 	{
-		memset(this->circleBuffer, 0, STREAM_BUFFER * sizeof(unsigned char));
+		// only streamed Players need the circular buffer
+		if (this->buffer->isStreamed())
+		{
+			this->circleBufferSize = this->streamBufferCount * this->streamBufferSize;
+			this->circleBuffer = new unsigned char[this->circleBufferSize];
+			memset(this->circleBuffer, 0, this->circleBufferSize * sizeof(unsigned char));
+		}
 	}
 
 	SDL_Player::~SDL_Player()
 	{
 		// AudioManager calls _stop before destruction
+		if (this->circleBuffer != NULL)
+		{
+			delete [] this->circleBuffer;
+		}
 	}
 
 	void SDL_Player::_getData(int size, unsigned char** data1, int* size1, unsigned char** data2, int* size2)
 	{
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
 			int streamSize = this->buffer->load(this->looping, size);
 			if (streamSize == 0)
@@ -43,14 +53,14 @@ namespace xal
 				*size2 = 0;
 				return;
 			}
-			hstream& stream = this->buffer->getStream();
-			*data1 = (unsigned char*)&stream[this->readPosition];
+			unsigned char* data = this->buffer->getData();
+			*data1 = &data[this->readPosition];
 			*size1 = hmin(hmin(streamSize, streamSize - this->readPosition), size);
 			*data2 = NULL;
 			*size2 = 0;
 			if (this->looping && this->readPosition + size > streamSize)
 			{
-				*data2 = (unsigned char*)stream;
+				*data2 = data;
 				*size2 = size - *size1;
 				this->readPosition = (this->readPosition + size) % streamSize;
 			}
@@ -64,13 +74,13 @@ namespace xal
 		*size1 = size;
 		*data2 = NULL;
 		*size2 = 0;
-		if (this->readPosition + size > STREAM_BUFFER)
+		if (this->readPosition + size > this->circleBufferSize)
 		{
-			*size1 = STREAM_BUFFER - this->readPosition;
+			*size1 = this->circleBufferSize - this->readPosition;
 			*data2 = this->circleBuffer;
 			*size2 = size - *size1;
 		}
-		this->readPosition = (this->readPosition + size) % STREAM_BUFFER;
+		this->readPosition = (this->readPosition + size) % this->circleBufferSize;
 	}
 
 	void SDL_Player::_update(float timeDelta)
@@ -97,6 +107,26 @@ namespace xal
 		{
 			return false;
 		}
+		unsigned char* output = (unsigned char*)stream;
+		if (this->startTime >= 0)
+		{
+			// a scheduled start begins at its exact sample within the mixed block
+			int frameSize = xal::manager->getChannels() * xal::manager->getBitsPerSample() / 8;
+			int64_t blockTime = ((SDL_AudioManager*)xal::manager)->outputSampleTime;
+			if (this->startTime >= blockTime + size / frameSize)
+			{
+				return false;
+			}
+			int offset = (int)hmax(this->startTime - blockTime, (int64_t)0) * frameSize;
+			this->scheduleError = hmax(blockTime - this->startTime, (int64_t)0);
+			this->startTime = -1;
+			output += offset;
+			size -= offset;
+			if (size <= 0)
+			{
+				return false;
+			}
+		}
 		unsigned char* data1 = NULL;
 		int size1 = 0;
 		unsigned char* data2 = NULL;
@@ -106,15 +136,15 @@ namespace xal
 		{
 			if (first && this->currentGain == 1.0f)
 			{
-				memcpy((unsigned char*)stream, data1, size1);
+				memcpy(output, data1, size1);
 				if (size2 > 0)
 				{
-					memcpy((void*)&stream[size1], data2, size2);
+					memcpy(&output[size1], data2, size2);
 				}
 			}
 			else
 			{
-				short* sStream = (short*)(unsigned char*)stream;
+				short* sStream = (short*)output;
 				short* sData1 = (short*)data1;
 				short* sData2 = (short*)data2;
 				size1 = size1 * sizeof(unsigned char) / sizeof(short);
@@ -156,7 +186,7 @@ namespace xal
 		}
 		else if (this->readPosition < this->writePosition)
 		{
-			count = (STREAM_BUFFER - this->writePosition + this->readPosition);
+			count = (this->circleBufferSize - this->writePosition + this->readPosition);
 		}
 		return this->buffer->calcInputSize(count);
 	}
@@ -178,7 +208,7 @@ namespace xal
 
 	void SDL_Player::_systemPrepareBuffer()
 	{
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
 			this->buffer->load(this->looping, this->buffer->getSize());
 			return;
@@ -187,10 +217,10 @@ namespace xal
 		{
 			this->readPosition = 0;
 			this->writePosition = 0;
-			int size = this->_fillBuffer(STREAM_BUFFER);
-			if (size < STREAM_BUFFER)
+			int size = this->_fillBuffer(this->circleBufferSize);
+			if (size < this->circleBufferSize)
 			{
-				memset(&this->circleBuffer[size], 0, (STREAM_BUFFER - size) * sizeof(unsigned char));
+				memset(&this->circleBuffer[size], 0, (this->circleBufferSize - size) * sizeof(unsigned char));
 			}
 		}
 	}
@@ -200,6 +230,33 @@ namespace xal
 		this->currentGain = this->_calcGain();
 	}
 
+	bool SDL_Player::_systemSetStartTime(int64_t outputSampleTime)
+	{
+		this->startTime = outputSampleTime;
+		return true;
+	}
+
+	bool SDL_Player::_systemSeek(unsigned int samplePosition)
+	{
+		// the data is already converted to the output format
+		int frameSize = xal::manager->getChannels() * xal::manager->getBitsPerSample() / 8;
+		this->position = this->buffer->calcOutputSize((int)(samplePosition * this->buffer->getChannels() * this->buffer->getBitsPerSample() * 0.125f));
+		this->position -= this->position % frameSize;
+		if (!this->buffer->isStreamed())
+		{
+			this->readPosition = this->position;
+			return true;
+		}
+		this->readPosition = 0;
+		this->writePosition = 0;
+		int size = this->_fillBuffer(this->circleBufferSize);
+		if (size < this->circleBufferSize)
+		{
+			memset(&this->circleBuffer[size], 0, (this->circleBufferSize - size) * sizeof(unsigned char));
+		}
+		return true;
+	}
+
 	void SDL_Player::_systemPlay()
 	{
 		this->playing = true;
@@ -208,6 +265,7 @@ namespace xal
 	int SDL_Player::_systemStop()
 	{
 		this->playing = false;
+		this->startTime = -1;
 		if (!this->paused)
 		{
 			this->position = 0;
@@ -224,15 +282,15 @@ namespace xal
 		int count = 0;
 		if (this->readPosition > this->writePosition)
 		{
-			count = (this->readPosition - this->writePosition) / STREAM_BUFFER_SIZE;
+			count = (this->readPosition - this->writePosition) / this->streamBufferSize;
 		}
 		else if (this->readPosition < this->writePosition)
 		{
-			count = (STREAM_BUFFER - this->writePosition + this->readPosition) / STREAM_BUFFER_SIZE;
+			count = (this->circleBufferSize - this->writePosition + this->readPosition) / this->streamBufferSize;
 		}
 		if (count > 0)
 		{
-			result = this->_fillBuffer(count * STREAM_BUFFER_SIZE);
+			result = this->_fillBuffer(count * this->streamBufferSize);
 			result = this->buffer->calcInputSize(result);
 		}
 		return result;
@@ -244,32 +302,32 @@ namespace xal
 		size = this->buffer->calcInputSize(size);
 		// load the data from the buffer
 		int streamSize = this->buffer->load(this->looping, size);
-		hstream& stream = this->buffer->getStream();
-		if (this->writePosition + streamSize <= STREAM_BUFFER)
+		unsigned char* data = this->buffer->getData();
+		if (this->writePosition + streamSize <= this->circleBufferSize)
 		{
-			memcpy(&this->circleBuffer[this->writePosition], (unsigned char*)stream, streamSize * sizeof(unsigned char));
+			memcpy(&this->circleBuffer[this->writePosition], data, streamSize * sizeof(unsigned char));
 		}
 		else
 		{
-			int remaining = STREAM_BUFFER - this->writePosition;
-			memcpy(&this->circleBuffer[this->writePosition], &stream[0], remaining * sizeof(unsigned char));
-			memcpy(this->circleBuffer, &stream[remaining], (streamSize - remaining) * sizeof(unsigned char));
+			int remaining = this->circleBufferSize - this->writePosition;
+			memcpy(&this->circleBuffer[this->writePosition], &data[0], remaining * sizeof(unsigned char));
+			memcpy(this->circleBuffer, &data[remaining], (streamSize - remaining) * sizeof(unsigned char));
 		}
-		this->writePosition = (this->writePosition + streamSize) % STREAM_BUFFER;
+		this->writePosition = (this->writePosition + streamSize) % this->circleBufferSize;
 		if (!this->looping && streamSize < size) // fill with silence if source is at the end
 		{
 			streamSize = size - streamSize;
-			if (this->writePosition + streamSize <= STREAM_BUFFER)
+			if (this->writePosition + streamSize <= this->circleBufferSize)
 			{
 				memset(&this->circleBuffer[this->writePosition], 0, streamSize * sizeof(unsigned char));
 			}
 			else
 			{
-				int remaining = STREAM_BUFFER - this->writePosition;
+				int remaining = this->circleBufferSize - this->writePosition;
 				memset(&this->circleBuffer[this->writePosition], 0, remaining * sizeof(unsigned char));
 				memset(this->circleBuffer, 0, (streamSize - remaining) * sizeof(unsigned char));
 			}
-			this->writePosition = (this->writePosition + streamSize) % STREAM_BUFFER;
+			this->writePosition = (this->writePosition + streamSize) % this->circleBufferSize;
 			streamSize = size;
 		}
 		return streamSize;
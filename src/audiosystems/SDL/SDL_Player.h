@@ -34,9 +34,11 @@ namespace xal
 		bool playing;
 		int position;
 		float currentGain;
-		unsigned char circleBuffer[STREAM_BUFFER];
+		unsigned char* circleBuffer;
+		int circleBufferSize;
 		int readPosition;
 		int writePosition;
+		int64_t startTime; // output sample time of a scheduled start or -1
 
 		void _update(float timeDelta);
 
@@ -47,6 +49,8 @@ namespace xal
 		bool _systemPreparePlay();
 		void _systemPrepareBuffer();
 		void _systemUpdateGain();
+		bool _systemSetStartTime(int64_t outputSampleTime);
+		bool _systemSeek(unsigned int samplePosition);
 		void _systemPlay();
 		int _systemStop();
 		int _systemUpdateStream();
@@ -9,7 +9,9 @@
 #ifdef _XAUDIO2
 #include <xaudio2.h>
 
+#include <hltypes/harray.h>
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hplatform.h>
 #include <hltypes/hstring.h>
 
@@ -22,7 +24,7 @@ using namespace Microsoft::WRL;
 namespace xal
 {
 	XAudio2_AudioManager::XAudio2_AudioManager(void* backendId, bool threaded, float updateTime, chstr deviceName) :
-		AudioManager(backendId, threaded, updateTime, deviceName), xa2Device(NULL), xa2MasteringVoice(NULL)
+		AudioManager(backendId, threaded, updateTime, deviceName), xa2Device(NULL), xa2MasteringVoice(NULL), lastOperationSet(XAUDIO2_COMMIT_NOW)
 	{
 		this->name = XAL_AS_XAUDIO2;
 		hlog::write(xal::logTag, "Initializing XAudio2.");
@@ -92,5 +94,23 @@ namespace xal
 		return new XAudio2_Player(sound);
 	}
 
+	void XAudio2_AudioManager::_systemPlayGroup(harray<Player*> players)
+	{
+		++this->lastOperationSet;
+		if (this->lastOperationSet == XAUDIO2_COMMIT_NOW)
+		{
+			++this->lastOperationSet;
+		}
+		// voices started in the same operation set begin on the same processing pass
+		harray<XAudio2_Player*> xa2Players = players.cast<XAudio2_Player*>();
+		foreach (XAudio2_Player*, it, xa2Players)
+		{
+			(*it)->operationSet = this->lastOperationSet;
+			(*it)->_systemPlay();
+			(*it)->operationSet = XAUDIO2_COMMIT_NOW;
+		}
+		this->xa2Device->CommitChanges(this->lastOperationSet);
+	}
+
 }
 #endif
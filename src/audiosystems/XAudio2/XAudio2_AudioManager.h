@@ -43,7 +43,10 @@ namespace xal
 		void resumeAudio();
 
 	protected:
+		unsigned int lastOperationSet;
+
 		Player* _createSystemPlayer(Sound* sound);
+		void _systemPlayGroup(harray<Player*> players);
 
 	};
 
@@ -64,19 +64,17 @@ namespace xal
 	}
 
 	XAudio2_Player::XAudio2_Player(Sound* sound) : Player(sound), playing(false), active(false),
-		stillPlaying(false), sourceVoice(NULL), buffersSubmitted(0)
+		stillPlaying(false), sourceVoice(NULL), buffersSubmitted(0), operationSet(XAUDIO2_COMMIT_NOW)
 	{
 		this->callbackHandler = new XAudio2_Player::CallbackHandler(&this->active);
 		memset(&this->xa2Buffer, 0, sizeof(XAUDIO2_BUFFER));
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		this->streamBuffers = NULL;
+		if (this->buffer->isStreamed())
 		{
-			this->streamBuffers[i] = NULL;
-		}
-		if (this->sound->isStreamed())
-		{
-			for_iter (i, 0, STREAM_BUFFER_COUNT)
+			this->streamBuffers = new unsigned char*[this->streamBufferCount];
+			for_iter (i, 0, this->streamBufferCount)
 			{
-				this->streamBuffers[i] = new unsigned char[STREAM_BUFFER_SIZE];
+				this->streamBuffers[i] = new unsigned char[this->streamBufferSize];
 			}
 		}
 	}
@@ -89,9 +87,13 @@ namespace xal
 			this->sourceVoice = NULL;
 		}
 		_HL_TRY_DELETE(this->callbackHandler);
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		if (this->streamBuffers != NULL)
 		{
-			_HL_TRY_DELETE_ARRAY(this->streamBuffers[i]);
+			for_iter (i, 0, this->streamBufferCount)
+			{
+				_HL_TRY_DELETE_ARRAY(this->streamBuffers[i]);
+			}
+			_HL_TRY_DELETE_ARRAY(this->streamBuffers);
 		}
 	}
 
@@ -142,15 +144,15 @@ namespace xal
 
 	void XAudio2_Player::_systemPrepareBuffer()
 	{
-		if (!this->sound->isStreamed())
+		if (!this->buffer->isStreamed())
 		{
 			if (!this->paused)
 			{
-				this->_submitBuffer(this->buffer->getStream());
+				this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			}
 			return;
 		}
-		int count = STREAM_BUFFER_COUNT;
+		int count = this->streamBufferCount;
 		if (this->paused)
 		{
 			this->sourceVoice->GetState(&this->xa2State[1], XAUDIO2_VOICE_NOSAMPLESPLAYED);
@@ -187,9 +189,50 @@ namespace xal
 		}
 	}
 
+	bool XAudio2_Player::_systemSeek(unsigned int samplePosition)
+	{
+		if (this->sourceVoice == NULL)
+		{
+			return false;
+		}
+		// the submitted buffers can't be replaced while the voice runs, decoding first limits the gap to the restart
+		int size = 0;
+		if (this->buffer->isStreamed())
+		{
+			size = this->buffer->load(this->looping, this->streamBufferCount * this->streamBufferSize);
+		}
+		if (this->playing)
+		{
+			this->sourceVoice->Stop();
+		}
+		this->sourceVoice->FlushSourceBuffers();
+		if (!this->buffer->isStreamed())
+		{
+			this->xa2Buffer.PlayBegin = samplePosition;
+			this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
+			this->xa2Buffer.PlayBegin = 0;
+		}
+		else
+		{
+			this->bufferIndex = 0;
+			this->buffersSubmitted = 0;
+			int count = this->_copyStreamBuffers(size);
+			if (count > 0)
+			{
+				this->_submitStreamBuffers(count);
+			}
+		}
+		if (this->playing)
+		{
+			this->sourceVoice->Start(0, XAUDIO2_COMMIT_NOW);
+			this->active = true;
+		}
+		return true;
+	}
+
 	void XAudio2_Player::_systemPlay()
 	{
-		HRESULT result = this->sourceVoice->Start();
+		HRESULT result = this->sourceVoice->Start(0, this->operationSet);
 		if (!FAILED(result))
 		{
 			this->playing = true;
@@ -211,19 +254,19 @@ namespace xal
 			{
 				if (this->paused)
 				{
-					if (this->sound->isStreamed())
+					if (this->buffer->isStreamed())
 					{
 						this->sourceVoice->GetState(&this->xa2State[2], XAUDIO2_VOICE_NOSAMPLESPLAYED);
 						int processed = this->buffersSubmitted - this->xa2State[2].BuffersQueued;
 						this->buffersSubmitted -= processed;
-						result = processed * STREAM_BUFFER_SIZE;
+						result = processed * this->streamBufferSize;
 					}
 				}
 				else
 				{
 					this->sourceVoice->FlushSourceBuffers();
 					this->buffer->rewind();
-					if (this->sound->isStreamed())
+					if (this->buffer->isStreamed())
 					{
 						this->buffersSubmitted = 0;
 					}
@@ -248,10 +291,15 @@ namespace xal
 			this->stillPlaying = true; // don't remove, it prevents streamed sounds from being stopped
 			return 0;
 		}
+		bool underrun = (processed >= this->buffersSubmitted);
 		this->buffersSubmitted -= processed;
 		int count = this->_fillStreamBuffers(processed);
 		if (count > 0)
 		{
+			if (underrun)
+			{
+				this->_registerUnderrun();
+			}
 			this->_submitStreamBuffers(count);
 			this->stillPlaying = true; // in case underrun happened, sound is regarded as stopped so let's just bitch-slap it and get this over with
 		}
@@ -260,13 +308,13 @@ namespace xal
 		{
 			this->_stop();
 		}
-		return (processed * STREAM_BUFFER_SIZE);
+		return (processed * this->streamBufferSize);
 	}
 
-	void XAudio2_Player::_submitBuffer(hstream& stream)
+	void XAudio2_Player::_submitBuffer(unsigned char* data, int size)
 	{
-		this->xa2Buffer.AudioBytes = (UINT32)stream.size();
-		this->xa2Buffer.pAudioData = (unsigned char*)stream;
+		this->xa2Buffer.AudioBytes = (UINT32)size;
+		this->xa2Buffer.pAudioData = data;
 		this->xa2Buffer.LoopCount = (this->looping ? XAUDIO2_LOOP_INFINITE : 0);
 		HRESULT result = this->sourceVoice->SubmitSourceBuffer(&this->xa2Buffer);
 		if (FAILED(result))
@@ -277,20 +325,25 @@ namespace xal
 
 	int XAudio2_Player::_fillStreamBuffers(int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		int filled = (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
-		hstream& stream = this->buffer->getStream();
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		return this->_copyStreamBuffers(size);
+	}
+
+	int XAudio2_Player::_copyStreamBuffers(int size)
+	{
+		int filled = (size + this->streamBufferSize - 1) / this->streamBufferSize;
+		unsigned char* data = this->buffer->getData();
 		int currentSize;
 		for_iter (i, 0, filled)
 		{
-			currentSize = hmin(size, STREAM_BUFFER_SIZE);
-			memcpy(this->streamBuffers[this->bufferIndex], &stream[i * STREAM_BUFFER_SIZE], currentSize);
-			if (currentSize < STREAM_BUFFER_SIZE)
+			currentSize = hmin(size, this->streamBufferSize);
+			memcpy(this->streamBuffers[this->bufferIndex], &data[i * this->streamBufferSize], currentSize);
+			if (currentSize < this->streamBufferSize)
 			{
-				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, STREAM_BUFFER_SIZE - currentSize);
+				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, this->streamBufferSize - currentSize);
 			}
-			this->bufferIndex = (this->bufferIndex + 1) % STREAM_BUFFER_COUNT;
-			size -= STREAM_BUFFER_SIZE;
+			this->bufferIndex = (this->bufferIndex + 1) % this->streamBufferCount;
+			size -= this->streamBufferSize;
 		}
 		return filled;
 	}
@@ -298,9 +351,9 @@ namespace xal
 	void XAudio2_Player::_submitStreamBuffers(int count)
 	{
 		HRESULT result;
-		this->xa2Buffer.AudioBytes = STREAM_BUFFER_SIZE;
+		this->xa2Buffer.AudioBytes = this->streamBufferSize;
 		this->xa2Buffer.LoopCount = 0;
-		int index = (this->bufferIndex + STREAM_BUFFER_COUNT - count) % STREAM_BUFFER_COUNT;
+		int index = (this->bufferIndex + this->streamBufferCount - count) % this->streamBufferCount;
 		for_iter (i, 0, count)
 		{
 			this->xa2Buffer.pAudioData = this->streamBuffers[index];
@@ -309,7 +362,7 @@ namespace xal
 			{
 				hlog::warn(xal::logTag, "Could not submit streamed source buffer!");
 			}
-			index = (index + 1) % STREAM_BUFFER_COUNT;
+			index = (index + 1) % this->streamBufferCount;
 		}
 		this->buffersSubmitted += count;
 	}
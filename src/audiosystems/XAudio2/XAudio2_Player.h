@@ -31,6 +31,8 @@ namespace xal
 	class xalExport XAudio2_Player : public Player
 	{
 	public:
+		friend class XAudio2_AudioManager;
+
 		class CallbackHandler : public IXAudio2VoiceCallback
 		{
 		public:
@@ -60,8 +62,9 @@ namespace xal
 		bool active;
 		bool stillPlaying;
 		CallbackHandler* callbackHandler;
-		unsigned char* streamBuffers[STREAM_BUFFER_COUNT]; // XAudio2 does not keep audio data alive so streamed audio has to be cached
+		unsigned char** streamBuffers; // XAudio2 does not keep audio data alive so streamed audio has to be cached
 		int buffersSubmitted;
+		unsigned int operationSet; // used to start multiple voices together
 
 		void _update(float timeDelta);
 
@@ -71,12 +74,14 @@ namespace xal
 		void _systemPrepareBuffer();
 		void _systemUpdateGain();
 		void _systemUpdatePitch();
+		bool _systemSeek(unsigned int samplePosition);
 		void _systemPlay();
 		int _systemStop();
 		int _systemUpdateStream();
 
-		void _submitBuffer(hstream& stream);
+		void _submitBuffer(unsigned char* data, int size);
 		int _fillStreamBuffers(int count);
+		int _copyStreamBuffers(int size);
 		void _submitStreamBuffers(int count);
 
 	private:
@@ -15,6 +15,7 @@
 
 #include <hltypes/harray.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
 #include <hltypes/hstring.h>
 
 #include "xalUtilExport.h"
@@ -53,9 +54,10 @@ namespace xal
 		void updateList();
 		/// @brief Updates playing list with curren queue.
 		/// @param[in] names List of Sound names.
-		/// @note Empties queue;
+		/// @note Empties queue; All started Sounds are started together on the same output frame.
 		void updateList(harray<hstr> names);
 		/// @brief Starts playing all Sound that are currently registered.
+		/// @note All Sounds are started together on the same output frame.
 		void playAll();
 		/// @brief Stops all Sounds completely.
 		void stopAll();
@@ -68,8 +70,8 @@ namespace xal
 	protected:
 		/// @brief How long to fade-in the Sounds.
 		float fadeTime;
-		/// @brief Players for the playing Sounds.
-		harray<Player*> players;
+		/// @brief Players for the playing Sounds, mapped by Sound name.
+		hmap<hstr, Player*> players;
 		/// @brief List of Sound names for playing.
 		harray<hstr> soundQueue;
 	
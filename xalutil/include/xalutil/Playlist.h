@@ -36,6 +36,8 @@ namespace xal
 		HL_DEFINE_ISSET(enabled, Enabled);
 		HL_DEFINE_IS(playing, Playing);
 		HL_DEFINE_ISSET(repeatAll, RepeatAll);
+		HL_DEFINE_GETSET(float, preloadTime, PreloadTime);
+		HL_DEFINE_GETSET(float, crossfadeTime, CrossfadeTime);
 		HL_DEFINE_GET(harray<Player*>, players, Players);
 		/// @return True if the Playlist is paused.
 		bool isPaused();
@@ -45,6 +47,7 @@ namespace xal
 		Player* getCurrentPlayer();
 		
 		/// @brief Updates the Playlist state.
+		/// @note The next Sound is preloaded and scheduled to start at the end of the current one so there is no gap between them.
 		void update();
 		
 		/// @brief Clears all Sounds from the Playlist.
@@ -84,6 +87,28 @@ namespace xal
 		int index;
 		/// @brief Array of Players.
 		harray<Player*> players;
+		/// @brief How long before the end of the current Sound the next one is preloaded (in seconds).
+		float preloadTime;
+		/// @brief How long the current Sound and the next one are crossfaded (in seconds).
+		/// @note A value of 0 means that there is no crossfade.
+		float crossfadeTime;
+		/// @brief The Player that was already preloaded.
+		Player* preloadedPlayer;
+		/// @brief Output sample time at which the current Player started.
+		/// @see AudioManager::getOutputSampleTime
+		int64_t startTime;
+		/// @brief Time of the last update in milliseconds.
+		int64_t lastUpdateTime;
+		/// @brief Time between the last two updates (in seconds).
+		float updateInterval;
+
+		/// @return The index of the Player following the current one.
+		/// @note The returned index is equal to the number of Players if there is no following Player.
+		int _getNextIndex();
+		/// @brief Switches to the next Player and starts playing it.
+		/// @param[in] fadeTime How long to fade-in the next Player.
+		/// @param[in] startTime Output sample time at which to start the next Player or -1 to start it immediately.
+		void _playNext(float fadeTime, int64_t startTime = -1);
 
 	};
 	
@@ -8,6 +8,7 @@
 
 #include <hltypes/harray.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
 #include <hltypes/hstring.h>
 #include <xal/AudioManager.h>
 #include <xal/Player.h>
@@ -29,28 +30,23 @@ namespace xal
 	
 	harray<hstr> ParallelSoundManager::getPlayingSounds()
 	{
-		harray<hstr> result;
-		foreach (Player*, it, this->players)
-		{
-			result += (*it)->getName();
-		}
-		return result;
+		return this->players.keys();
 	}
 
 	void ParallelSoundManager::stopSoundsWithPrefix(chstr prefix)
 	{
-		harray<Player*> lst;
-		foreach (Player*, it, this->players)
+		harray<hstr> names;
+		foreach_m (Player*, it, this->players)
 		{
-			if ((*it)->getName().startsWith(prefix))
+			if (it->first.startsWith(prefix))
 			{
-				xal::manager->destroyPlayer(*it);
-				lst += *it;
+				xal::manager->destroyPlayer(it->second);
+				names += it->first;
 			}
 		}
-		foreach (Player*, it, lst)
+		foreach (hstr, it, names)
 		{
-			this->players.remove(*it);
+			this->players.removeKey(*it);
 		}
 	}
 	
@@ -61,23 +57,19 @@ namespace xal
 
 	void ParallelSoundManager::removeSound(chstr name)
 	{
-		bool found = false;
+		if (!this->players.hasKey(name))
+		{
+			return;
+		}
 		harray<hstr> queue;
-		foreach (Player*, it, this->players)
+		foreach_m (Player*, it, this->players)
 		{
-			if ((*it)->getName() == name)
-			{
-				found = true;
-			}
-			else if ((*it)->isPlaying())
+			if (it->first != name && it->second->isPlaying())
 			{
-				queue += (*it)->getName();
+				queue += it->first;
 			}
 		}
-		if (found)
-		{
-			updateList(queue);
-		}
+		this->updateList(queue);
 	}
 
 	void ParallelSoundManager::updateList()
@@ -88,46 +80,50 @@ namespace xal
 
 	void ParallelSoundManager::updateList(harray<hstr> names)
 	{
-		harray<Player*> removeList;
-		foreach (Player*, it, this->players)
+		hmap<hstr, bool> requested;
+		foreach (hstr, it, names)
+		{
+			requested[*it] = true;
+		}
+		harray<hstr> removeList;
+		harray<Player*> startList;
+		foreach_m (Player*, it, this->players)
 		{
-			if (names.has((*it)->getName()))
+			if (requested.hasKey(it->first))
 			{
-				names -= (*it)->getName();
-				if (!(*it)->isPlaying())
+				requested.removeKey(it->first);
+				if (!it->second->isPlaying())
 				{
-					(*it)->play(this->fadeTime, true);
+					startList += it->second;
 				}
 			}
-			else if ((*it)->isPlaying())
+			else if (it->second->isPlaying())
 			{
-				(*it)->pause(this->fadeTime);
+				it->second->pause(this->fadeTime);
 			}
 			else
 			{
-				xal::manager->destroyPlayer(*it);
-				removeList += *it;
+				xal::manager->destroyPlayer(it->second);
+				removeList += it->first;
 			}
 		}
-		foreach (Player*, it, removeList)
+		foreach (hstr, it, removeList)
 		{
-			this->players.remove(*it);
+			this->players.removeKey(*it);
 		}
 		Player* player = NULL;
-		foreach (hstr, it, names)
+		foreach_m (bool, it, requested)
 		{
-			player = xal::manager->createPlayer(*it);
-			player->play(this->fadeTime, true);
-			this->players += player;
+			player = xal::manager->createPlayer(it->first);
+			this->players[it->first] = player;
+			startList += player;
 		}
+		xal::manager->playGroup(startList, this->fadeTime, true);
 	}
 	
 	void ParallelSoundManager::playAll()
 	{
-		foreach (Player*, it, this->players)
-		{
-			(*it)->play(this->fadeTime, true);
-		}
+		xal::manager->playGroup(this->players.values(), this->fadeTime, true);
 	}
 	
 	void ParallelSoundManager::stopAll()
@@ -137,17 +133,17 @@ namespace xal
 	
 	void ParallelSoundManager::pauseAll()
 	{
-		foreach (Player*, it, this->players)
+		foreach_m (Player*, it, this->players)
 		{
-			(*it)->pause(this->fadeTime);
+			it->second->pause(this->fadeTime);
 		}
 	}
 
 	void ParallelSoundManager::clear()
 	{
-		foreach (Player*, it, this->players)
+		foreach_m (Player*, it, this->players)
 		{
-			xal::manager->destroyPlayer(*it);
+			xal::manager->destroyPlayer(it->second);
 		}
 		this->players.clear();
 		this->soundQueue.clear();
@@ -16,7 +16,7 @@
 
 namespace xal
 {
-	Playlist::Playlist(bool repeatAll) : enabled(true), playing(false), index(-1)
+	Playlist::Playlist(bool repeatAll) : enabled(true), playing(false), index(-1), preloadTime(1.0f), crossfadeTime(0.0f), preloadedPlayer(NULL), startTime(0), lastUpdateTime(0), updateInterval(0.0f)
 	{
 		this->repeatAll = repeatAll;
 	}
@@ -48,40 +48,87 @@ namespace xal
 	
 	void Playlist::update()
 	{
+		int64_t time = htickCount();
+		if (this->lastUpdateTime > 0)
+		{
+			this->updateInterval = (time - this->lastUpdateTime) * 0.001f;
+		}
+		this->lastUpdateTime = time;
 		if (this->enabled)
 		{
 			if (this->players.size() == 0 || !this->playing || this->index < 0)
 			{
 				return;
 			}
-			if (this->repeatAll)
+			if (this->index >= this->players.size())
 			{
-				if (!this->players[this->index]->isPlaying())
-				{
-					this->index = (this->index + 1) % this->players.size();
-					this->players[this->index]->play(0.0f, (this->players.size() == 1));
-				}
+				this->playing = false;
+				return;
 			}
-			else if (this->index < this->players.size())
+			Player* player = this->players[this->index];
+			if (!player->isPlaying())
 			{
-				if (!this->players[this->index]->isPlaying())
+				this->_playNext(0.0f);
+				return;
+			}
+			int next = this->_getNextIndex();
+			if (next == this->index || next >= this->players.size())
+			{
+				return;
+			}
+			// the reported position lags behind the output by the queued data so the end is taken from the output clock instead
+			int samplingRate = xal::manager->getSamplingRate();
+			int64_t endTime = this->startTime + (int64_t)(player->getDuration() * samplingRate);
+			float remaining = (float)(endTime - xal::manager->getOutputSampleTime()) / samplingRate;
+			if (remaining <= this->preloadTime && this->preloadedPlayer != this->players[next])
+			{
+				this->players[next]->preload();
+				this->preloadedPlayer = this->players[next];
+			}
+			if (this->crossfadeTime > 0.0f)
+			{
+				if (remaining <= this->crossfadeTime)
 				{
-					++this->index;
-					if (this->index < this->players.size())
-					{
-						this->players[this->index]->play();
-					}
-					else
-					{
-						this->playing = false;
-					}
+					remaining = hmax(remaining, 0.0f);
+					player->stop(remaining);
+					this->_playNext(remaining);
 				}
 			}
+			// the next Sound is scheduled on the output clock before the next update could be too late for it
+			else if (remaining <= xal::manager->getScheduleLookahead() + this->updateInterval)
+			{
+				this->_playNext(0.0f, endTime);
+			}
+		}
+	}
+
+	int Playlist::_getNextIndex()
+	{
+		return (this->repeatAll ? (this->index + 1) % this->players.size() : this->index + 1);
+	}
+
+	void Playlist::_playNext(float fadeTime, int64_t startTime)
+	{
+		this->index = this->_getNextIndex();
+		this->preloadedPlayer = NULL;
+		if (this->index < this->players.size())
+		{
+			bool looping = (this->repeatAll && this->players.size() == 1);
+			if (startTime >= 0)
+			{
+				this->players[this->index]->playAt(startTime, fadeTime, looping);
+				this->startTime = startTime;
+			}
 			else
 			{
-				this->playing = false;
+				this->players[this->index]->play(fadeTime, looping);
+				this->startTime = xal::manager->getOutputSampleTime();
 			}
 		}
+		else
+		{
+			this->playing = false;
+		}
 	}
 	
 	void Playlist::clear()
@@ -93,6 +140,7 @@ namespace xal
 		}
 		this->players.clear();
 		this->index = -1;
+		this->preloadedPlayer = NULL;
 	}
 	
 	void Playlist::queueSound(chstr name)
@@ -121,7 +169,10 @@ namespace xal
 			this->index = 0;
 		}
 		bool looping = (this->players.size() == 1 && this->repeatAll);
-		this->players[this->index]->play(fadeTime, looping);
+		Player* player = this->players[this->index];
+		// a paused Player continues from its position
+		this->startTime = xal::manager->getOutputSampleTime() - (int64_t)(player->getTimePosition() * xal::manager->getSamplingRate());
+		player->play(fadeTime, looping);
 		if (this->enabled)
 		{
 			this->playing = true;